@@ -12,16 +12,24 @@ static generic_vector gen_vec(void)
 
 static void init_chunk(chunk *c)
 {
-	c->lines     = NULL;
 	c->ip        = NULL;
 	c->constants = NULL;
+	c->hits      = NULL;
+	c->cycles    = NULL;
 	c->len       = STACK_SIZE;
 	c->count     = 0;
 
-	c->cases     = gen_vec();
-	c->ip        = ALLOC(STACK_SIZE);
-	c->lines     = ALLOC(STACK_SIZE * sizeof(uint16_t));
-	c->constants = GROW_STACK(NULL, STACK_SIZE);
+	c->lines.bytes  = NULL;
+	c->lines.count  = 0;
+	c->lines.len    = STACK_SIZE;
+	c->lines.offset = 0;
+	c->lines.line   = 0;
+	c->lines.col    = 0;
+
+	c->cases       = gen_vec();
+	c->ip          = ALLOC(STACK_SIZE);
+	c->lines.bytes = ALLOC(STACK_SIZE);
+	c->constants   = GROW_STACK(NULL, STACK_SIZE);
 }
 
 function *_function(_key *name)
@@ -36,17 +44,57 @@ function *_function(_key *name)
 	return func;
 }
 
-void write_chunk(chunk *c, uint8_t byte, uint16_t line)
+static void put_varint(line_table *l, uint32_t n)
+{
+	for (; n >= 0x80; n >>= 7)
+		l->bytes[l->count++] = (uint8_t)(n | 0x80);
+	l->bytes[l->count++] = (uint8_t)n;
+}
+
+static uint32_t get_varint(const uint8_t *bytes, int *i)
 {
+	uint32_t n     = 0;
+	int      shift = 0;
 
-	size_t size = 0;
+	while (bytes[*i] & 0x80)
+	{
+		n |= (uint32_t)(bytes[(*i)++] & 0x7F) << shift;
+		shift += 7;
+	}
+	return n | (uint32_t)bytes[(*i)++] << shift;
+}
+
+static void add_run(line_table *l, int offset, int line, int col)
+{
+	if (l->len < l->count + LINE_RUN_MAX)
+	{
+		l->bytes = REALLOC(l->bytes, l->len, l->len * INC);
+		l->len *= INC;
+	}
+
+	int doff  = offset - l->offset;
+	int dline = line - l->line;
+
+	if (doff < 16 && dline >= 0 && dline < 8)
+		l->bytes[l->count++] = (uint8_t)(doff << 3 | dline);
+	else
+	{
+		l->bytes[l->count++] = 0x80;
+		put_varint(l, (uint32_t)doff);
+		put_varint(l, ZIGZAG(dline));
+	}
+	put_varint(l, ZIGZAG(col - l->col));
+
+	l->offset = offset;
+	l->line   = line;
+	l->col    = col;
+}
+
+void write_chunk(chunk *c, uint8_t byte, int line, int col)
+{
 	if (c->len < c->count + 1)
 	{
-		size     = c->len * INC;
-		c->ip    = REALLOC(c->ip, c->len, size);
-		c->lines = REALLOC(
-		    c->lines, c->len * sizeof(uint16_t), size * sizeof(uint16_t)
-		);
+		c->ip = REALLOC(c->ip, c->len, c->len * INC);
 		c->len *= INC;
 	}
 	if (c->cases.len < c->cases.count + 1)
@@ -57,8 +105,62 @@ void write_chunk(chunk *c, uint8_t byte, uint16_t line)
 		c->cases.len *= INC;
 	}
 
-	*(c->lines + c->count) = line;
-	*(c->ip + c->count++)  = byte;
+	if (c->lines.count == 0 || line != c->lines.line || col != c->lines.col)
+		add_run(&c->lines, c->count, line, col);
+
+	*(c->ip + c->count++) = byte;
+}
+
+/* Walks the runs up to `offset`; the table is only read on errors, by the
+ * disassembler and by the profiler, never while dispatching. */
+int chunk_line(chunk *c, int offset, int *col)
+{
+	const uint8_t *bytes = c->lines.bytes;
+
+	uint32_t delta  = 0;
+	int      at     = 0;
+	int      line   = 0;
+	int      column = 0;
+
+	for (int i = 0; i < c->lines.count;)
+	{
+		int doff  = bytes[i] >> 3;
+		int dline = bytes[i] & 0x07;
+
+		if (bytes[i++] & 0x80)
+		{
+			doff  = (int)get_varint(bytes, &i);
+			delta = get_varint(bytes, &i);
+			dline = UNZIGZAG(delta);
+		}
+		delta    = get_varint(bytes, &i);
+		int dcol = UNZIGZAG(delta);
+
+		if (at + doff > offset)
+			break;
+
+		at += doff;
+		line += dline;
+		column += dcol;
+	}
+
+	if (col)
+		*col = column;
+	return line;
+}
+
+int reserve_cases(chunk *c, int n)
+{
+	while (c->cases.len < c->cases.count + n + 1)
+	{
+		size_t size = c->cases.len * INC * sizeof(uint16_t);
+		c->cases.bytes =
+		    REALLOC(c->cases.bytes, c->cases.len * sizeof(uint16_t), size);
+		c->cases.len *= INC;
+	}
+
+	c->cases.count += n;
+	return c->cases.count - n;
 }
 
 int add_constant(chunk *c, element ar)
@@ -10,9 +10,11 @@
 #ifdef DEBUG_TRACE_EXECUTION
 #include "debug.h"
 #endif
+#include <errno.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #define UPPER(x) ((uint8_t)((x >> 8) & 0xFF))
@@ -32,10 +34,17 @@ static void init_compiler(compiler *a, compiler *b, compiler_t type, _key *name)
 	a->meta.type  = type;
 	a->meta.flags = 0;
 
+	a->stack.object   = NULL;
+	a->stack.objects  = 0;
+	a->stack.literal  = NULL;
+	a->stack.literals = 0;
+	a->meta.call  = -1;
+
 	a->count.local   = 0;
 	a->count.scope   = 0;
 	a->count.obj     = 0;
 	a->count.upvalue = 0;
+	a->count.capture = 0;
 
 	a->array.index = 0;
 	a->array.set   = 0;
@@ -57,8 +66,13 @@ static void init_compiler(compiler *a, compiler *b, compiler_t type, _key *name)
 	else
 		_local = &a->stack.local[a->count.local++];
 
-	_local->depth    = 0;
-	_local->captured = false;
+	/* The function's own slot. Nested, it belongs to the enclosing block
+	 * so the block's end_scope walks past it; it has no stack value. */
+	_local->name.hash = 0;
+	_local->name.val  = NULL;
+	_local->depth     = b ? b->count.scope : 0;
+	_local->captured  = false;
+	_local->assigned  = false;
 }
 
 static void consume(token_t t, const char *err, parser *parser)
@@ -105,6 +119,60 @@ static char *get_name(char *path)
 
 	return file;
 }
+static bool is_library(const char *path)
+{
+	const char *ext = strrchr(path, '.');
+	return ext && (strcmp(ext, ".so") == 0 || strcmp(ext, ".dylib") == 0);
+}
+
+/* Native libraries are bound while compiling: their natives take object
+ * slots in this script like classes do, and the script installs them with
+ * OP_SET_OBJ, so calls resolve to their slot directly. */
+static void import_library(compiler *c, const char *path)
+{
+	const yk_native_def *defs = NULL;
+	const char          *err  = NULL;
+
+	consume(
+	    TOKEN_CH_SEMI, "Expect `;` at end of include/import statement.",
+	    &c->parser
+	);
+
+	if (yk_open_library(path, &defs, &err))
+	{
+		prev_error(err, &c->parser);
+		return;
+	}
+
+	for (; defs->name; defs++)
+	{
+		if (c->base->count.obj > UINT8_MAX)
+		{
+			prev_error(
+			    "Native libraries must be imported before the 256th object.",
+			    &c->parser
+			);
+			return;
+		}
+
+		size_t  len  = strlen(defs->name);
+		_key   *ar   = Key(defs->name, len);
+		native *nat  = _native(defs->fn, Key(defs->name, len));
+		int     slot = new_object(c);
+
+		nat->arity = defs->arity;
+		shadow_native(c, ar);
+		write_table(c->base->lookup, ar, NumType(slot, T_NATIVE));
+
+		reserve_object(c->base, slot);
+		c->base->stack.object[slot] = GEN(nat, T_NATIVE);
+
+		emit_args(
+		    c, OP_SET_OBJ, slot, add_constant(&c->func->ch, GEN(nat, T_NATIVE))
+		);
+	}
+}
+
 static void include_file(compiler *c)
 {
 	if (c->meta.type != COMPILER_TYPE_SCRIPT)
@@ -123,6 +191,12 @@ static void include_file(compiler *c)
 	strcpy(path, (char *)c->base->meta.cwd);
 	strcat(path, inc->val);
 
+	if (is_library(inc->val))
+	{
+		import_library(c, path);
+		return;
+	}
+
 	/* Load and execute the module at compile-time; its globals become
 	 * available. */
 	char *err = NULL;
@@ -264,18 +338,21 @@ static void class_declaration(compiler *c)
 	if (find_entry(&c->lookup, ar).type != T_NULL)
 		exit_error("Duplicate class declaration: %s\n", ar->val);
 
-	write_table(c->base->lookup, ar, NumType(c->base->count.obj, T_CLASS));
+	int slot = new_object(c);
+
+	write_table(c->base->lookup, ar, NumType(slot, T_CLASS));
 
-	c->base->stack.class[c->base->count.obj] = NULL;
-	c->base->stack.class[c->base->count.obj] = classc;
+	reserve_object(c->base, slot);
+	c->base->stack.object[slot] = GEN(classc, T_CLASS);
 
 	cc->name          = *ar;
-	cc->index         = c->base->count.obj;
+	cc->index         = slot;
 	cc->enclosing     = c->class_compiler;
 	c->class_compiler = cc;
 
-	emit_bytes(c, OP_SET_OBJ, c->base->count.obj++);
-	emit_byte(c, add_constant(&c->func->ch, GEN(classc, T_CLASS)));
+	emit_args(
+	    c, OP_SET_OBJ, slot, add_constant(&c->func->ch, GEN(classc, T_CLASS))
+	);
 
 	if (match(TOKEN_CH_SEMI, &c->parser))
 	{
@@ -312,7 +389,11 @@ static void method_body(compiler *c, compiler_t type, _key *ar, class **class)
 	compiler co;
 	init_compiler(&co, c, type, ar);
 
+	/* The receiver sits in slot 0, ahead of the parameters. */
+	_key self = {c->base->hash.this, "this"};
+
 	c = &co;
+	add_local(c, &self);
 	begin_scope(c);
 	consume(TOKEN_CH_LPAREN, "Expect `(` after function name.", &c->parser);
 	if (!check(TOKEN_CH_RPAREN, &c->parser))
@@ -349,28 +430,92 @@ static void method_body(compiler *c, compiler_t type, _key *ar, class **class)
 
 	c = c->enclosing;
 
-	emit_bytes(
-	    c, OP_METHOD, add_constant(&c->func->ch, GEN(clos, T_CLOSURE))
-	);
-
-	for (int i = 0; i < tmp->count.upvalue; i++)
-		emit_bytes(
-		    c, tmp->stack.upvalue[i].islocal ? 1 : 0,
-		    (uint8_t)tmp->stack.upvalue[i].index
-		);
+	emit_arg(c, OP_METHOD, add_constant(&c->func->ch, GEN(clos, T_CLOSURE)));
+	emit_captures(c, tmp);
 }
 
 static void call(compiler *c)
 {
 	uint8_t argc = argument_list(c);
+
+	c->meta.call = c->func->ch.count;
 	emit_bytes(c, OP_CALL, argc);
 }
-static void call_instance(compiler *c)
+/* Builtins lowered to a single opcode when called directly by name. */
+static const struct
 {
-	uint8_t argc = argument_list(c);
-	emit_bytes(c, OP_INSTANCE, argc);
+	const char *name;
+	opcode_t    op;
+} intrinsics[] = {
+    {"square", OP_SQRT}, {"sqrt", OP_SQRT}, {"abs", OP_ABS},
+    {"floor", OP_FLOOR}, {"min", OP_MIN},   {"max", OP_MAX},
+    {"pow", OP_POW},     {NULL, 0},
+};
+
+static int resolve_intrinsic(int slot)
+{
+	for (int i = 0; builtin_natives[i].name; i++)
+	{
+		if (i != slot)
+			continue;
+
+		for (int j = 0; intrinsics[j].name; j++)
+			if (strcmp(intrinsics[j].name, builtin_natives[i].name) == 0)
+				return intrinsics[j].op;
+	}
+	return -1;
 }
 
+/* Natives are called in place: arguments are pushed with no callee below
+ * them and OP_CALL_NATIVE leaves the result in the first argument's slot. */
+/* A library native imported by this script, else a builtin. */
+static int native_arity(compiler *c, int slot)
+{
+	element *obj = c->base->stack.object;
+
+	if (slot < c->base->stack.objects && obj[slot].type == T_NATIVE)
+		return NATIVE(obj[slot])->arity;
+
+	return yk_native_arity((uint8_t)slot);
+}
+
+static void call_native(compiler *c, int slot)
+{
+	if (slot == -1)
+	{
+		prev_error("Undefined native function.", &c->parser);
+		return;
+	}
+
+	if (!match(TOKEN_CH_LPAREN, &c->parser))
+	{
+		emit_arg(c, OP_GET_OBJ, slot);
+		return;
+	}
+
+	uint8_t argc  = argument_list(c);
+	int     arity = native_arity(c, slot);
+
+	if (arity != YK_VARIADIC && arity != argc)
+	{
+		char err[64];
+		snprintf(
+		    err, sizeof(err), "Expected `%d` args, but got `%d`.", arity, argc
+		);
+		prev_error(err, &c->parser);
+		return;
+	}
+
+	int op = resolve_intrinsic(slot);
+
+	if (op != -1)
+		emit_byte(c, op);
+	else
+	{
+		emit_bytes(c, OP_CALL_NATIVE, (uint8_t)slot);
+		emit_byte(c, argc);
+	}
+}
 static int argument_list(compiler *c)
 {
 	uint8_t argc = 0;
@@ -398,12 +543,12 @@ static void func_declaration(compiler *c)
 	_key *ar = NULL;
 	ar       = parse_id(c);
 
+	shadow_native(c, ar);
+
 	if (find_entry(&c->base->lookup, ar).type != T_NULL)
 		exit_error("Duplicate function declarations");
 
-	write_table(
-	    c->base->lookup, ar, NumType(c->base->count.obj++, T_FUNCTION)
-	);
+	write_table(c->base->lookup, ar, NumType(new_object(c), T_FUNCTION));
 
 	func_body(c, ar);
 }
@@ -448,15 +593,8 @@ static void func_body(compiler *c, _key *ar)
 
 	int arg = add_constant(&c->func->ch, GEN(clos, T_CLOSURE));
 
-	emit_bytes(c, OP_CLOSURE, arg);
-
-	emit_byte(c, obj_count);
-
-	for (int i = 0; i < tmp->count.upvalue; i++)
-		emit_bytes(
-		    c, tmp->stack.upvalue[i].islocal ? 1 : 0,
-		    tmp->stack.upvalue[i].index
-		);
+	emit_args(c, OP_CLOSURE, arg, obj_count);
+	emit_captures(c, tmp);
 }
 
 static void func_var(compiler *c)
@@ -475,7 +613,7 @@ static void func_var(compiler *c)
 		glob = resolve_local(c, ar);
 		set  = OP_SET_LOCAL_PARAM;
 	}
-	emit_bytes(c, set, (uint8_t)glob);
+	emit_arg(c, set, glob);
 }
 
 static void var_dec(compiler *c)
@@ -488,7 +626,10 @@ static void var_dec(compiler *c)
 
 	uint8_t set = 0;
 	if (glob != -1)
+	{
+		shadow_native(c, ar);
 		set = OP_GLOBAL_DEF;
+	}
 	else
 	{
 		glob = resolve_local(c, ar);
@@ -498,7 +639,7 @@ static void var_dec(compiler *c)
 	if (match(TOKEN_OP_ASSIGN, &c->parser))
 	{
 		expression(c);
-		emit_bytes(c, set, (uint8_t)glob);
+		emit_arg(c, set, glob);
 	}
 	else
 		emit_byte(c, OP_NOOP);
@@ -578,10 +719,10 @@ static void rm_statement(compiler *c)
 		get = OP_GET_UPVALUE;
 	else
 	{
-		arg = add_constant(&c->func->ch, KeyEl(ar));
+		arg = key_constant(c, ar);
 		get = OP_GET_GLOBAL;
 	}
-	emit_bytes(c, get, (uint8_t)arg);
+	emit_arg(c, get, arg);
 	emit_byte(c, OP_RM);
 	consume(TOKEN_CH_RPAREN, "Expect `)` after rm statement", &c->parser);
 	consume(TOKEN_CH_SEMI, "Expect `;` at end of statement", &c->parser);
@@ -600,7 +741,15 @@ static void for_statement(compiler *c)
 	if (!match(TOKEN_CH_SEMI, &c->parser))
 	{
 		if (match(TOKEN_VAR, &c->parser))
+		{
 			var_dec(c);
+
+			if (counted_loop(c))
+			{
+				end_scope(c);
+				return;
+			}
+		}
 		else
 			id(c);
 	}
@@ -640,6 +789,93 @@ static void for_statement(compiler *c)
 	end_scope(c);
 }
 
+static bool is_local(token *t, local *l)
+{
+	return t->type == TOKEN_ID && l->name.val &&
+	       (size_t)t->size == strlen(l->name.val) &&
+	       memcmp(t->start, l->name.val, t->size) == 0;
+}
+
+/* resolve_local for a token that has not been consumed yet. */
+static int token_local(compiler *c, token *t)
+{
+	for (int i = c->count.local - 1; i >= 0; i--)
+		if (is_local(t, &c->stack.local[i]))
+			return i;
+	return -1;
+}
+
+/* `for (var i = a; i < n; i++)`, with `<=` or `++i` allowed and `n` a
+ * literal or a local, tests and steps the counter in place with one
+ * OP_FOR_LOOP per iteration. Anything else takes the generic path. */
+static bool counted_loop(compiler *c)
+{
+	local  *l = &c->stack.local[c->count.local - 1];
+	scanner s = scan;
+	token   t[7];
+
+	t[0] = c->parser.cur;
+	for (int i = 1; i < 7; i++)
+		t[i] = scan_token();
+	scan = s;
+
+	bool post = is_local(&t[4], l) && t[5].type == TOKEN_OP_INC;
+	bool pre  = t[4].type == TOKEN_OP_INC && is_local(&t[5], l);
+
+	if (!is_local(&t[0], l) ||
+	    (t[1].type != TOKEN_OP_LT && t[1].type != TOKEN_OP_LE) ||
+	    t[3].type != TOKEN_CH_SEMI || !(post || pre) ||
+	    t[6].type != TOKEN_CH_RPAREN)
+		return false;
+
+	uint8_t flags = (t[1].type == TOKEN_OP_LE) ? FOR_LE : 0;
+	int     limit = -1;
+
+	/* The fused loop only has one-byte operands. */
+	if (c->count.local > UINT8_MAX + 1)
+		return false;
+
+	if (t[2].type == TOKEN_ID)
+	{
+		limit = token_local(c, &t[2]);
+		flags |= FOR_LOCAL;
+	}
+	else if (t[2].type == TOKEN_NUMBER)
+		/* Last, as it adds to the chunk. Should the index not fit, the
+		 * generic path's `i < n` reuses the deduplicated constant. */
+		limit = make_constant(c, number(&t[2]));
+
+	if (limit == -1 || limit > UINT8_MAX)
+		return false;
+
+	for (int i = 0; i < 7; i++)
+		advance_compiler(&c->parser);
+
+	uint8_t slot = (uint8_t)(c->count.local - 1);
+	l->assigned  = true;
+
+	emit_bytes(c, OP_FOR_PREP, slot);
+	emit_bytes(c, flags, (uint8_t)limit);
+	emit_bytes(c, 0xFF, 0xFF);
+
+	int exit = c->func->ch.count - 2;
+	int body = c->func->ch.count;
+
+	statement(c);
+
+	emit_bytes(c, OP_FOR_LOOP, slot);
+	emit_bytes(c, flags, (uint8_t)limit);
+
+	int offset = c->func->ch.count - body + 2;
+
+	if (offset > UINT16_MAX)
+		prev_error("ERROR: big boi loop", &c->parser);
+
+	emit_bytes(c, UPPER(offset), LOWER(offset));
+	patch_jump(c, exit);
+	return true;
+}
+
 static void while_statement(compiler *c)
 {
 	int start = c->func->ch.count;
@@ -692,54 +928,33 @@ static void switch_statement(compiler *c)
 	consume_switch(c);
 	match(TOKEN_CH_LCURL, &c->parser);
 
-	case_statement(c);
+	if (jump_table(c))
+		return;
 
-	if (match(TOKEN_DEFAULT, &c->parser))
-	{
-		consume(
-		    TOKEN_CH_COLON, "Expect `:` prior to case body.", &c->parser
-		);
-		while (!match(TOKEN_CH_RCURL, &c->parser))
-			statement(c);
-	}
-	match(TOKEN_CH_RCURL, &c->parser);
+	if (!case_statement(c))
+		default_case(c);
 
 	c->func->ch.cases.bytes[c->func->ch.cases.count++] = c->func->ch.count;
 }
 
-static void case_statement(compiler *c)
+static bool case_statement(compiler *c)
 {
-	uint8_t get = c->array.get;
-	uint8_t arg = c->array.index;
+	uint8_t get    = c->array.get;
+	int     arg    = c->array.index;
+	bool    closed = false;
 
-	while (match(TOKEN_CASE, &c->parser))
+	while (!closed && match(TOKEN_CASE, &c->parser))
 	{
 		expression(c);
 		consume(
 		    TOKEN_CH_COLON, "Expect `:` prior to case body.", &c->parser
 		);
-		emit_bytes(c, get, (uint8_t)arg);
+		emit_arg(c, get, arg);
 		emit_byte(c, OP_EQ);
 
 		int exit = emit_jump(c, OP_JMPF);
 
-		while (!check(TOKEN_BREAK, &c->parser))
-		{
-			statement(c);
-
-			if (match(TOKEN_CH_RCURL, &c->parser))
-				break;
-			if (match(TOKEN_BREAK, &c->parser))
-			{
-				consume(
-				    TOKEN_CH_SEMI,
-				    "Expected a semi colon after break "
-				    "statement",
-				    &c->parser
-				);
-				break;
-			}
-		}
+		closed = case_body(c);
 		emit_byte(c, OP_JMPL);
 		emit_bytes(
 		    c, (c->func->ch.cases.count >> 8) & 0xFF,
@@ -747,6 +962,253 @@ static void case_statement(compiler *c)
 		);
 		patch_jump(c, exit);
 	}
+	return closed;
+}
+
+/* A case body runs up to `break;`, the next label, or the switch's closing
+ * brace; returns true when it consumed that brace. */
+static bool case_body(compiler *c)
+{
+	for (;;)
+	{
+		if (match(TOKEN_BREAK, &c->parser))
+		{
+			consume(
+			    TOKEN_CH_SEMI,
+			    "Expected a semi colon after break statement", &c->parser
+			);
+			return false;
+		}
+		if (match(TOKEN_CH_RCURL, &c->parser))
+			return true;
+		if (check(TOKEN_CASE, &c->parser) ||
+		    check(TOKEN_DEFAULT, &c->parser) || check(TOKEN_EOF, &c->parser))
+			return false;
+
+		statement(c);
+	}
+}
+
+static void default_case(compiler *c)
+{
+	if (match(TOKEN_DEFAULT, &c->parser))
+	{
+		consume(
+		    TOKEN_CH_COLON, "Expect `:` prior to case body.", &c->parser
+		);
+		if (case_body(c))
+			return;
+	}
+	consume(TOKEN_CH_RCURL, "Expect `}` after switch statement.", &c->parser);
+}
+
+/* Reads one `case` label ahead of the parser: an integer, char or string
+ * literal followed by `:`. Every label must be of the same kind. */
+static bool case_label(element *label, token_t *kind)
+{
+	token t   = scan_token();
+	bool  neg = t.type == TOKEN_OP_SUB;
+
+	if (neg)
+		t = scan_token();
+	if (*kind == TOKEN_EOF)
+		*kind = t.type;
+	if (t.type != *kind || (neg && t.type != TOKEN_NUMBER))
+		return false;
+
+	switch (t.type)
+	{
+	case TOKEN_NUMBER:
+		*label = number(&t);
+		if (label->type != T_INT)
+			return false;
+		if (neg)
+			label->val.Int = -label->val.Int;
+		break;
+	case TOKEN_CHAR:
+		*label = Int(char_literal(&t));
+		break;
+	case TOKEN_STR:
+		*label = KeyEl(Key(t.start + 1, t.size - 2));
+		break;
+	default:
+		return false;
+	}
+
+	return scan_token().type == TOKEN_CH_COLON;
+}
+
+static int constant_cases(compiler *c, element *labels, token_t *kind)
+{
+	scanner s     = scan;
+	token   t     = c->parser.cur;
+	int     depth = 1;
+	int     n     = 0;
+
+	*kind = TOKEN_EOF;
+
+	for (; depth > 0 && t.type != TOKEN_EOF; t = scan_token())
+	{
+		if (t.type == TOKEN_CH_LCURL)
+			depth++;
+		else if (t.type == TOKEN_CH_RCURL)
+			depth--;
+		else if (t.type == TOKEN_CASE && depth == 1 &&
+		         (n == CASE_COUNT || !case_label(&labels[n++], kind)))
+		{
+			n = 0;
+			break;
+		}
+	}
+	scan = s;
+
+	return n;
+}
+
+/* Maps each label to its slot in the table: the key's offset from the
+ * smallest key when dense, its rank among the distinct keys when sparse,
+ * and the index of its first occurrence for strings. */
+static int case_slots(element *labels, int n, int *slot, token_t kind,
+                      element *keys)
+{
+	if (kind == TOKEN_STR)
+	{
+		table *t = alloc_table(MIN_SIZE);
+
+		for (int i = 0; i < n; i++)
+		{
+			element j = find_entry(&t, KEY(labels[i]));
+
+			if (j.type == T_NULL)
+				write_table(t, KEY(labels[i]), Int(slot[i] = i));
+			else if (find_text(t, KEY(labels[i])).type == T_NULL)
+				return -1;
+			else
+				slot[i] = j.val.Int;
+		}
+		*keys = GEN(t, T_TABLE);
+		return SWITCH_STRING;
+	}
+
+	Long min = labels[0].val.Int, max = min;
+
+	for (int i = 1; i < n; i++)
+	{
+		min = (labels[i].val.Int < min) ? labels[i].val.Int : min;
+		max = (labels[i].val.Int > max) ? labels[i].val.Int : max;
+	}
+
+	uint8_t chars = (kind == TOKEN_CHAR) ? SWITCH_CHAR : 0;
+
+	if ((unsigned long long)max - (unsigned long long)min < 2ull * n)
+	{
+		for (int i = 0; i < n; i++)
+			slot[i] = (int)(labels[i].val.Int - min);
+		*keys = Int(min);
+		return SWITCH_DENSE | chars;
+	}
+
+	vector *v = _vector(n, T_INT);
+
+	for (int i = 0; i < n; i++)
+	{
+		int j = 0;
+
+		while (j < v->count && v->of[j].Int < labels[i].val.Int)
+			j++;
+		if (j == v->count || v->of[j].Int != labels[i].val.Int)
+		{
+			memmove(v->of + j + 1, v->of + j, (v->count - j) * sizeof(value));
+			v->of[j].Int = labels[i].val.Int;
+			v->count++;
+		}
+	}
+	for (int i = 0; i < n; i++)
+	{
+		slot[i] = 0;
+		while (v->of[slot[i]].Int != labels[i].val.Int)
+			slot[i]++;
+	}
+	*keys = GEN(v, T_VECTOR);
+	return SWITCH_SPARSE | chars;
+}
+
+/* A switch whose labels are all integer, char or string literals jumps
+ * straight to its case through a table in ch.cases instead of testing
+ * each label in turn:
+ *
+ *	cases[base]         number of slots
+ *	cases[base + 1]     default target
+ *	cases[base + 2 + i] target of slot i
+ *
+ * Targets are offsets from the start of the chunk, as for OP_JMPL. */
+static bool jump_table(compiler *c)
+{
+	element labels[CASE_COUNT];
+	int     slot[CASE_COUNT];
+	int     exits[CASE_COUNT];
+	token_t kind;
+	element keys;
+
+	int n = constant_cases(c, labels, &kind);
+
+	/* The key table's constant index is a single byte. */
+	if (n == 0 || c->func->ch.constants->count > UINT8_MAX)
+		return false;
+
+	int type = case_slots(labels, n, slot, kind, &keys);
+
+	if (type == -1)
+		return false;
+
+	int size = 0;
+
+	for (int i = 0; i < n; i++)
+		size = (slot[i] + 1 > size) ? slot[i] + 1 : size;
+
+	chunk *ch   = &c->func->ch;
+	int    base = reserve_cases(ch, size + 2);
+
+	ch->cases.bytes[base] = size;
+	for (int i = 1; i < size + 2; i++)
+		ch->cases.bytes[base + i] = UINT16_MAX;
+
+	emit_bytes(c, OP_SWITCH, (uint8_t)type);
+	emit_bytes(c, (uint8_t)add_constant(ch, keys), UPPER(base));
+	emit_byte(c, LOWER(base));
+
+	bool closed = false;
+	int  i      = 0;
+
+	for (; i < n && !closed; i++)
+	{
+		consume(TOKEN_CASE, "Expect `case` label.", &c->parser);
+		match(TOKEN_OP_SUB, &c->parser);
+		advance_compiler(&c->parser);
+		consume(
+		    TOKEN_CH_COLON, "Expect `:` prior to case body.", &c->parser
+		);
+
+		if (ch->cases.bytes[base + 2 + slot[i]] == UINT16_MAX)
+			ch->cases.bytes[base + 2 + slot[i]] = ch->count;
+
+		closed   = case_body(c);
+		exits[i] = emit_jump(c, OP_JMP);
+	}
+
+	ch->cases.bytes[base + 1] = ch->count;
+
+	if (!closed)
+		default_case(c);
+
+	while (i-- > 0)
+		patch_jump(c, exits[i]);
+
+	for (int i = 2; i < size + 2; i++)
+		if (ch->cases.bytes[base + i] == UINT16_MAX)
+			ch->cases.bytes[base + i] = ch->cases.bytes[base + 1];
+
+	return true;
 }
 
 static void if_statement(compiler *c)
@@ -828,10 +1290,32 @@ static void return_statement(compiler *c)
 		    TOKEN_CH_SEMI,
 		    "ERROR: Expect semi colon after return statement.", &c->parser
 		);
+		tail_call(c);
 		emit_byte(c, OP_RETURN);
 	}
 }
 
+/* A call that is the last instruction of a returned expression reuses the
+ * caller's frame. The OP_RETURN after it stays for any jump that lands
+ * past the call. */
+static void tail_call(compiler *c)
+{
+	if (c->meta.call == -1)
+		return;
+
+	uint8_t *op  = c->func->ch.ip + c->meta.call;
+	int      len = 3;
+
+	/* A wide OP_INVOKE has the prefix and a second key byte. */
+	if (*op == OP_WIDE)
+		op++, len = 5;
+
+	if (*op == OP_CALL && c->meta.call + 2 == c->func->ch.count)
+		*op = OP_TAIL_CALL;
+	else if (*op == OP_INVOKE && c->meta.call + len == c->func->ch.count)
+		*op = OP_TAIL_INVOKE;
+}
+
 static void patch_jump(compiler *c, int offset)
 {
 
@@ -896,17 +1380,31 @@ static void end_scope(compiler *c)
 {
 
 	c->count.scope--;
-	int count = -1;
+	int count = 0;
+	int close = -1;
 	while (c->count.local > 0 &&
 	       (c->stack.local[c->count.local - 1].depth > c->count.scope))
 	{
-		count++;
+		local *l = &c->stack.local[c->count.local - 1];
+
+		if (l->captured && l->assigned)
+			close = c->count.local - 1;
+		if (l->name.val)
+			count++;
 		c->count.local--;
 	}
+	resolve_captures(c, c->count.local);
 
-	if (count == 0)
+	if (close != -1)
+		emit_arg(c, OP_CLOSE_UPVAL, close);
+
+	/* OP_POPN carries its count as a byte operand. */
+	for (; count > UINT8_MAX; count -= UINT8_MAX)
+		emit_bytes(c, OP_POPN, UINT8_MAX);
+
+	if (count == 1)
 		emit_byte(c, OP_POP);
-	else if (count >= 1)
+	else if (count > 1)
 		emit_bytes(c, OP_POPN, count);
 }
 
@@ -1128,6 +1626,12 @@ static void binary(compiler *c)
 	case TOKEN_OP_LE:
 		emit_byte(c, OP_LE);
 		break;
+	case TOKEN_LG_AND:
+		emit_byte(c, OP_BIT_AND);
+		break;
+	case TOKEN_LG_OR:
+		emit_byte(c, OP_BIT_OR);
+		break;
 
 	default:
 		return;
@@ -1144,11 +1648,13 @@ static void unary(compiler *c)
 
 	case TOKEN_OP_INC:
 		emit_byte(c, OP_INC);
-		emit_bytes(c, c->array.set, c->array.index);
+		emit_arg(c, c->array.set, c->array.index);
+		assign(c, c->array.set, c->array.index);
 		break;
 	case TOKEN_OP_DEC:
 		emit_byte(c, OP_DEC);
-		emit_bytes(c, c->array.set, c->array.index);
+		emit_arg(c, c->array.set, c->array.index);
+		assign(c, c->array.set, c->array.index);
 		break;
 	case TOKEN_OP_SUB:
 	case TOKEN_OP_BANG:
@@ -1189,7 +1695,8 @@ static void compound_assign(compiler *c)
 		emit_byte(c, OP_OR);
 		break;
 	}
-	emit_bytes(c, c->array.set, c->array.index);
+	emit_arg(c, c->array.set, c->array.index);
+	assign(c, c->array.set, c->array.index);
 }
 
 static void infix_unary(compiler *c)
@@ -1211,7 +1718,8 @@ static void infix_unary(compiler *c)
 	default:
 		return;
 	}
-	emit_bytes(c, c->array.set, c->array.index);
+	emit_arg(c, c->array.set, c->array.index);
+	assign(c, c->array.set, c->array.index);
 }
 
 static void current_err(const char *err, parser *parser)
@@ -1226,7 +1734,8 @@ static void error_at(Token toke, parser *parser, const char *err)
 {
 	if (parser->flag)
 		return;
-	parser->flag = 1;
+	parser->flag  = 1;
+	parser->error = true;
 
 	fprintf(
 	    stderr, "[file: %s, line: %d:%d] Error", parser->current_file,
@@ -1249,26 +1758,231 @@ static void emit_return(compiler *c)
 }
 static void emit_byte(compiler *c, uint8_t byte)
 {
-	write_chunk(&c->func->ch, byte, c->parser.pre.line);
+	write_chunk(&c->func->ch, byte, c->parser.pre.line, c->parser.pre.col);
 }
 static void emit_bytes(compiler *c, uint8_t b1, uint8_t b2)
 {
-	write_chunk(&c->func->ch, b1, c->parser.pre.line);
-	write_chunk(&c->func->ch, b2, c->parser.pre.line);
+	write_chunk(&c->func->ch, b1, c->parser.pre.line, c->parser.pre.col);
+	write_chunk(&c->func->ch, b2, c->parser.pre.line, c->parser.pre.col);
+}
+static void emit_short(compiler *c, int arg)
+{
+	if (arg > UINT16_MAX)
+		prev_error("ERROR: Operand index does not fit in 16 bits.", &c->parser);
+	emit_bytes(c, UPPER(arg), LOWER(arg));
+}
+
+/* One-byte operands cover nearly every program. Past that, constants get
+ * OP_CONSTANT_LONG and anything else is prefixed with OP_WIDE, which makes
+ * every index operand of the instruction two bytes. */
+static void emit_arg(compiler *c, uint8_t op, int arg)
+{
+	if (arg <= UINT8_MAX)
+		emit_bytes(c, op, (uint8_t)arg);
+	else
+	{
+		if (op == OP_CONSTANT)
+			emit_byte(c, OP_CONSTANT_LONG);
+		else
+			emit_bytes(c, OP_WIDE, op);
+		emit_short(c, arg);
+	}
+}
+
+static void emit_args(compiler *c, uint8_t op, int a, int b)
+{
+	if (a <= UINT8_MAX && b <= UINT8_MAX)
+	{
+		emit_bytes(c, op, (uint8_t)a);
+		emit_byte(c, (uint8_t)b);
+		return;
+	}
+	emit_bytes(c, OP_WIDE, op);
+	emit_short(c, a);
+	emit_short(c, b);
+}
+
+/* Numbers, chars, booleans, null and keys never change once compiled, so
+ * each distinct one is added to a function's constants only once. Strings,
+ * tables and vectors are modified in place by the VM and are not shared. */
+static bool is_literal(element el)
+{
+	switch (el.type)
+	{
+	case T_NUM:
+	case T_INT:
+	case T_CHAR:
+	case T_BOOL:
+	case T_NULL:
+	case T_KEY:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static uint32_t literal_hash(element el)
+{
+	uint64_t bits = 0;
+
+	switch (el.type)
+	{
+	case T_NUM:
+		memcpy(&bits, &el.val.Num, sizeof(double));
+		break;
+	case T_INT:
+		bits = (uint64_t)el.val.Int;
+		break;
+	case T_CHAR:
+		bits = (uint8_t)el.val.Char;
+		break;
+	case T_BOOL:
+		bits = el.val.Bool;
+		break;
+	case T_KEY:
+		bits = (uint32_t)KEY(el)->hash;
+		break;
+	default:
+		break;
+	}
+	return (uint32_t)((bits ^ (bits >> 32)) * 2654435761u) ^ el.type;
+}
+
+static bool same_literal(element a, element b)
+{
+	if (a.type != b.type)
+		return false;
+
+	switch (a.type)
+	{
+	case T_NUM:
+		return memcmp(&a.val.Num, &b.val.Num, sizeof(double)) == 0;
+	case T_INT:
+		return a.val.Int == b.val.Int;
+	case T_CHAR:
+		return a.val.Char == b.val.Char;
+	case T_BOOL:
+		return a.val.Bool == b.val.Bool;
+	case T_KEY:
+		return KEY(a) == KEY(b);
+	default:
+		return true;
+	}
+}
+
+static void index_literal(compiler *c, int index)
+{
+	element *as   = c->func->ch.constants->as;
+	int      mask = c->stack.literals - 1;
+	uint32_t i    = literal_hash(as[index]) & mask;
+
+	while (c->stack.literal[i])
+		i = (i + 1) & mask;
+	c->stack.literal[i] = index + 1;
+}
+
+static void grow_literals(compiler *c)
+{
+	stack *constants = c->func->ch.constants;
+
+	FREE(c->stack.literal);
+	c->stack.literals = c->stack.literals ? c->stack.literals * 2 : INIT_SIZE;
+	c->stack.literal  = ALLOC(sizeof(int) * c->stack.literals);
+	memset(c->stack.literal, 0, sizeof(int) * c->stack.literals);
+
+	for (int i = 0; i < constants->count; i++)
+		if (is_literal(constants->as[i]))
+			index_literal(c, i);
+}
+
+static int make_constant(compiler *c, element el)
+{
+	chunk *ch = &c->func->ch;
+
+	if (!is_literal(el))
+		return add_constant(ch, el);
+
+	if (ch->constants->count * 2 >= c->stack.literals)
+		grow_literals(c);
+
+	int      mask = c->stack.literals - 1;
+	uint32_t i    = literal_hash(el) & mask;
+
+	for (; c->stack.literal[i]; i = (i + 1) & mask)
+		if (same_literal(ch->constants->as[c->stack.literal[i] - 1], el))
+			return c->stack.literal[i] - 1;
+
+	c->stack.literal[i] = add_constant(ch, el) + 1;
+	return c->stack.literal[i] - 1;
+}
+
+/* Keys are interned in the VM's literal pool, so every function and module
+ * naming the same identifier or property refers to one copy of it. The
+ * pool takes a copy; `ar` stays with the caller. */
+static int key_constant(compiler *c, _key *ar)
+{
+	element el = find_entry(&machine.literals, ar);
+
+	if (el.type != T_KEY || strcmp(KEY(el)->val, ar->val) != 0)
+	{
+		_key *k = Key(ar->val, strlen(ar->val));
+
+		push(&machine.stack.literal, KeyEl(k));
+		if (el.type == T_NULL)
+			write_table(machine.literals, k, KeyEl(k));
+		el = KeyEl(k);
+	}
+	return make_constant(c, el);
 }
+
 static void emit_constant(compiler *c, element ar)
 {
-	emit_bytes(c, OP_CONSTANT, add_constant(&c->func->ch, ar));
+	emit_arg(c, OP_CONSTANT, make_constant(c, ar));
+}
+
+static element number(token *t)
+{
+	if (!memchr(t->start, '.', t->size))
+	{
+		errno  = 0;
+		Long n = strtoll(t->start, NULL, 10);
+
+		if (errno != ERANGE)
+			return Int(n);
+	}
+	return Num(strtod(t->start, NULL));
 }
 
 static void num(compiler *c)
 {
-	emit_constant(c, Num(strtod(c->parser.pre.start, NULL)));
+	emit_constant(c, number(&c->parser.pre));
+}
+
+/* The character a `'c'` token stands for; `\n`, `\t`, `\r` and `\0` are
+ * escapes, and a backslash before anything else yields that character. */
+static char char_literal(token *t)
+{
+	if (t->start[1] != '\\')
+		return t->start[1];
+
+	switch (t->start[2])
+	{
+	case 'n':
+		return '\n';
+	case 't':
+		return '\t';
+	case 'r':
+		return '\r';
+	case '0':
+		return '\0';
+	default:
+		return t->start[2];
+	}
 }
 
 static void ch(compiler *c)
 {
-	emit_constant(c, Char(*++c->parser.pre.start));
+	emit_constant(c, Char(char_literal(&c->parser.pre)));
 }
 
 static void str(compiler *c)
@@ -1346,7 +2060,7 @@ static void fmt_str(compiler *c)
 static void boolean(compiler *c)
 {
 	if (*c->parser.pre.start == 'n')
-		emit_bytes(c, OP_CONSTANT, add_constant(&c->func->ch, Null()));
+		emit_constant(c, Null());
 	else
 		emit_constant(c, Bool(*c->parser.pre.start == 't' ? true : false));
 }
@@ -1370,6 +2084,16 @@ static void _table(compiler *c)
 	emit_constant(c, GEN(t, T_TABLE));
 }
 
+/* A top-level declaration takes a builtin's name over for the rest of the
+ * script, so the name no longer resolves to the native. */
+static void shadow_native(compiler *c, _key *ar)
+{
+	element *el = find_ref(c->base->lookup, ar);
+
+	if (el && el->type == T_NATIVE)
+		*el = Null();
+}
+
 static int resolve_native(compiler *c, _key *ar)
 {
 
@@ -1385,10 +2109,13 @@ static void parse_native_var_arg(compiler *c)
 
 	_key *key = NULL;
 	key       = parse_id(c);
-	int arg   = resolve_native(c, key);
-	emit_bytes(c, OP_GET_OBJ, (uint8_t)arg);
-	consume(TOKEN_CH_LPAREN, "Expect `(` prior to function call", &c->parser);
-	call(c);
+
+	if (!check(TOKEN_CH_LPAREN, &c->parser))
+	{
+		current_err("Expect `(` prior to function call", &c->parser);
+		return;
+	}
+	call_native(c, resolve_native(c, key));
 }
 
 static _key *parse_id(compiler *c)
@@ -1416,7 +2143,7 @@ static vector *char_vector(compiler *c)
 	do
 	{
 		advance_compiler(&c->parser);
-		element e = Char(*++c->parser.pre.start);
+		element e = Char(char_literal(&c->parser.pre));
 		push_value(&v, &e);
 	} while (match(TOKEN_CH_COMMA, &c->parser));
 
@@ -1582,8 +2309,12 @@ static void _access(compiler *c)
 	{
 
 	case TOKEN_STR:
-		emit_constant(c, GEN(parse_string(c), T_KEY));
+	{
+		_key *k = parse_string(c);
+		emit_arg(c, OP_CONSTANT, key_constant(c, k));
+		free_key(&k);
 		break;
+	}
 	case TOKEN_NUMBER:
 		num(c);
 		break;
@@ -1702,7 +2433,7 @@ static void dot(compiler *c)
 	_key *ar = NULL;
 	ar       = parse_id(c);
 
-	int arg = add_constant(&c->func->ch, KeyEl(ar));
+	int arg = key_constant(c, ar);
 
 	c->array.get   = OP_GET_PROP;
 	c->array.set   = OP_SET_PROP;
@@ -1722,10 +2453,18 @@ static void dot(compiler *c)
 	else if (match(TOKEN_OP_ASSIGN, &c->parser))
 	{
 		expression(c);
-		emit_bytes(c, OP_SET_PROP, arg);
+		emit_arg(c, OP_SET_PROP, arg);
+	}
+	else if (match(TOKEN_CH_LPAREN, &c->parser))
+	{
+		uint8_t argc = argument_list(c);
+
+		c->meta.call = c->func->ch.count;
+		emit_arg(c, OP_INVOKE, arg);
+		emit_byte(c, argc);
 	}
 	else
-		emit_bytes(c, OP_GET_PROP, arg);
+		emit_arg(c, OP_GET_PROP, arg);
 }
 
 static void _this(compiler *c)
@@ -1739,7 +2478,14 @@ static void _this(compiler *c)
 		);
 		return;
 	}
-	emit_byte(c, OP_THIS);
+
+	_key self = {c->base->hash.this, "this"};
+	int  arg  = resolve_local(c, &self);
+
+	if (arg != -1)
+		emit_arg(c, OP_GET_LOCAL, arg);
+	else if ((arg = resolve_upvalue(c, &self)) != -1)
+		emit_bytes(c, OP_GET_UPVALUE, (uint8_t)arg);
 }
 
 static void id(compiler *c)
@@ -1755,27 +2501,24 @@ static void id(compiler *c)
 
 	if (arg != -1)
 	{
-		emit_bytes(c, OP_GET_OBJ, (uint8_t)arg);
+		emit_arg(c, OP_GET_OBJ, arg);
 		return;
 	}
 
 	if ((arg = resolve_class(c, ar)) != -1)
 	{
-		uint8_t init = 0;
+		emit_arg(c, OP_ALLOC_INSTANCE, arg);
 
-		if (c->base->stack.class[arg]->init)
+		if (CLASS(c->base->stack.object[arg])->init)
 		{
 			match(TOKEN_CH_LPAREN, &c->parser);
-			emit_bytes(c, OP_CLASS, (uint8_t)arg);
-			call(c);
-			init = 1;
+			emit_bytes(c, OP_INIT, argument_list(c));
 		}
-
-		emit_bytes(c, OP_ALLOC_INSTANCE, (uint8_t)arg);
-		emit_byte(c, init);
-
-		if (match(TOKEN_CH_LPAREN, &c->parser))
-			call_instance(c);
+		else if (match(TOKEN_CH_LPAREN, &c->parser) && argument_list(c))
+			prev_error(
+			    "ERROR: A class without `init` takes no arguments.",
+			    &c->parser
+			);
 		return;
 	}
 
@@ -1789,8 +2532,14 @@ static void id(compiler *c)
 		get = OP_GET_UPVALUE;
 		set = OP_SET_UPVALUE;
 	}
+	else if ((arg = resolve_native(c, ar)) != -1)
+	{
+		/* Builtins only bind names the script has not declared. */
+		call_native(c, arg);
+		return;
+	}
 	else
-		arg = add_constant(&c->func->ch, KeyEl(ar));
+		arg = key_constant(c, ar);
 
 	c->array.set   = set;
 	c->array.get   = get;
@@ -1799,10 +2548,11 @@ static void id(compiler *c)
 	if (match(TOKEN_OP_ASSIGN, &c->parser))
 	{
 		expression(c);
-		emit_bytes(c, set, (uint8_t)arg);
+		emit_arg(c, set, arg);
+		assign(c, set, arg);
 	}
 	else
-		emit_bytes(c, get, (uint8_t)arg);
+		emit_arg(c, get, arg);
 }
 
 static int parse_var(compiler *c, _key *ar)
@@ -1810,7 +2560,7 @@ static int parse_var(compiler *c, _key *ar)
 	declare_var(c, ar);
 	if (c->count.scope > 0)
 		return -1;
-	return add_constant(&c->func->ch, KeyEl(ar));
+	return key_constant(c, ar);
 }
 
 static bool idcmp(_key *a, _key *b)
@@ -1836,12 +2586,12 @@ static int resolve_upvalue(compiler *c, _key *name)
 	if (local != -1)
 	{
 		c->enclosing->stack.local[local].captured = true;
-		return add_upvalue(c, (uint8_t)local, true);
+		return add_upvalue(c, local, true);
 	}
 
 	int upvalue = resolve_upvalue(c->enclosing, name);
 	if (upvalue != -1)
-		return add_upvalue(c, (uint8_t)upvalue, false);
+		return add_upvalue(c, upvalue, false);
 
 	return -1;
 }
@@ -1858,7 +2608,7 @@ static int add_upvalue(compiler *c, int index, bool islocal)
 			return i;
 	}
 
-	if (count > LOCAL_COUNT)
+	if (count == UPVALUE_COUNT)
 	{
 		prev_error(
 		    "ERROR: To many closure variables in function.", &c->parser
@@ -1867,10 +2617,75 @@ static int add_upvalue(compiler *c, int index, bool islocal)
 	}
 
 	c->stack.upvalue[c->count.upvalue].islocal = islocal;
-	c->stack.upvalue[c->count.upvalue].index   = (uint8_t)index;
+	c->stack.upvalue[c->count.upvalue].index   = (uint16_t)index;
 	return c->count.upvalue++;
 }
 
+/* Writes the upvalue descriptors of `inner` after its OP_CLOSURE or
+ * OP_METHOD. Locals start out captured by reference; resolve_captures
+ * turns the ones that are never reassigned into copies. */
+static void emit_captures(compiler *c, compiler *inner)
+{
+	for (int i = 0; i < inner->count.upvalue; i++)
+	{
+		upvalue *up = &inner->stack.upvalue[i];
+
+		uint8_t  kind = up->islocal ? CAPTURE_LOCAL : CAPTURE_UPVALUE;
+
+		if (up->islocal && c->count.capture < CAPTURE_COUNT)
+		{
+			capture *cap = &c->stack.capture[c->count.capture++];
+			cap->local   = up->index;
+			cap->offset  = c->func->ch.count;
+		}
+
+		if (up->index > UINT8_MAX)
+		{
+			emit_byte(c, kind | CAPTURE_WIDE);
+			emit_short(c, up->index);
+		}
+		else
+			emit_bytes(c, kind, (uint8_t)up->index);
+	}
+}
+
+/* Settles the pending captures of every local from `from` up, once
+ * nothing more can be assigned to them. */
+static void resolve_captures(compiler *c, int from)
+{
+	for (int i = c->count.capture - 1; i >= 0; i--)
+	{
+		capture *cap = &c->stack.capture[i];
+
+		if (cap->local < from)
+			continue;
+
+		if (!c->stack.local[cap->local].assigned)
+		{
+			uint8_t *kind = c->func->ch.ip + cap->offset;
+			*kind         = (*kind & CAPTURE_WIDE) | CAPTURE_COPY;
+		}
+
+		*cap = c->stack.capture[--c->count.capture];
+	}
+}
+
+/* Marks the local behind a store as reassigned, following upvalues out
+ * to the function that owns it. */
+static void assign(compiler *c, uint8_t set, int index)
+{
+	if (set == OP_SET_LOCAL)
+		c->stack.local[index].assigned = true;
+	else if (set == OP_SET_UPVALUE && c->enclosing)
+	{
+		upvalue *up = &c->stack.upvalue[index];
+		assign(
+		    c->enclosing, up->islocal ? OP_SET_LOCAL : OP_SET_UPVALUE,
+		    up->index
+		);
+	}
+}
+
 static void declare_var(compiler *c, _key *ar)
 {
 	if (c->count.scope == 0)
@@ -1893,6 +2708,32 @@ static void declare_var(compiler *c, _key *ar)
 	add_local(c, ar);
 }
 
+/* Hands out the next object slot for a function or class. */
+static int new_object(compiler *c)
+{
+	if (c->base->count.obj == UINT16_MAX)
+		prev_error("ERROR: Too many objects in one script.", &c->parser);
+	return c->base->count.obj++;
+}
+
+/* Classes and library natives are looked up by object slot, so the table
+ * on the base compiler grows to cover `slot`. */
+static void reserve_object(compiler *base, int slot)
+{
+	if (slot < base->stack.objects)
+		return;
+
+	int      len     = (slot < INIT_SIZE) ? INIT_SIZE : slot * INC;
+	element *objects = ALLOC(sizeof(element) * len);
+
+	for (int i = 0; i < len; i++)
+		objects[i] = (i < base->stack.objects) ? base->stack.object[i] : Null();
+
+	FREE(base->stack.object);
+	base->stack.object  = objects;
+	base->stack.objects = len;
+}
+
 static void add_local(compiler *c, _key *ar)
 {
 	if (c->count.local == LOCAL_COUNT)
@@ -1905,6 +2746,7 @@ static void add_local(compiler *c, _key *ar)
 	c->stack.local[c->count.local].name     = *ar;
 	c->stack.local[c->count.local].depth    = c->count.scope;
 	c->stack.local[c->count.local].captured = false;
+	c->stack.local[c->count.local].assigned = false;
 	c->count.local++;
 }
 static function *end_compile(compiler *a)
@@ -1912,6 +2754,12 @@ static function *end_compile(compiler *a)
 	function *f = a->func;
 
 	emit_return(a);
+	resolve_captures(a, 0);
+	f->uargc = a->count.upvalue;
+
+	FREE(a->stack.literal);
+	a->stack.literal  = NULL;
+	a->stack.literals = 0;
 #ifdef DEBUG_PRINT_CODE
 	if (!a->parser.flag)
 		disassemble_chunk(&a->func->ch, a->func->name.as.String);
@@ -1937,13 +2785,15 @@ function *compile(const char *src, table **lookup)
 	c.base            = &c;
 	c.base->lookup    = NULL;
 	c.base->lookup    = *lookup;
-	c.base->count.obj = 3;
+	c.base->count.obj = machine.count.native;
 	c.hash.init       = hash_key("init");
+	c.hash.this       = hash_key("this");
 	c.hash.len        = hash_key("len");
 	c.hash.push       = hash_key("push");
 	c.hash.pop        = hash_key("pop");
 
 	c.parser.flag         = false;
+	c.parser.error        = false;
 	c.parser.current_file = NULL;
 
 	advance_compiler(&c.parser);
@@ -1953,12 +2803,14 @@ function *compile(const char *src, table **lookup)
 	consume(TOKEN_EOF, "Expect end of expression", &c.parser);
 
 	function *f = end_compile(&c);
+	f->objc     = c.base->count.obj;
 
 	FREE((char *)(c.parser.current_file));
 	FREE(c.base->lookup->records);
 	FREE(c.base->lookup);
+	FREE(c.stack.object);
 
-	return c.parser.flag ? NULL : f;
+	return c.parser.error ? NULL : f;
 }
 
 function *compile_path(const char *src, const char *path, const char *name)
@@ -1976,6 +2828,7 @@ function *compile_path(const char *src, const char *path, const char *name)
 	c.base->lookup = GROW_TABLE(NULL, INIT_SIZE);
 
 	c.hash.init   = hash_key("init");
+	c.hash.this   = hash_key("this");
 	c.hash.len    = hash_key("len");
 	c.hash.push   = hash_key("push");
 	c.hash.pop    = hash_key("pop");
@@ -1983,19 +2836,14 @@ function *compile_path(const char *src, const char *path, const char *name)
 	c.hash.delete = hash_key("delete");
 
 	c.parser.flag         = false;
+	c.parser.error        = false;
 	c.parser.current_file = name;
 
-	write_table(
-	    c.base->lookup, Key("clock", 5),
-	    NumType(c.base->count.obj++, T_NATIVE)
-	);
-	write_table(
-	    c.base->lookup, Key("square", 6),
-	    NumType(c.base->count.obj++, T_NATIVE)
-	);
-	write_table(
-	    c.base->lookup, Key("file", 4), NumType(c.base->count.obj++, T_NATIVE)
-	);
+	for (const yk_native_def *n = builtin_natives; n->name; n++)
+		write_table(
+		    c.base->lookup, Key(n->name, strlen(n->name)),
+		    NumType(c.base->count.obj++, T_NATIVE)
+		);
 
 	advance_compiler(&c.parser);
 
@@ -2009,6 +2857,7 @@ function *compile_path(const char *src, const char *path, const char *name)
 	FREE((char *)(c.parser.current_file));
 	FREE(c.base->lookup->records);
 	FREE(c.base->lookup);
+	FREE(c.stack.object);
 
-	return c.parser.flag ? NULL : f;
+	return c.parser.error ? NULL : f;
 }
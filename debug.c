@@ -1,6 +1,109 @@
 #include "debug.h"
 #include <stdio.h>
 
+static const char *names[OP_COUNT] = {
+	[OP_CONSTANT]         = "OP_CONSTANT",
+	[OP_CONSTANT_LONG]    = "OP_CONSTANT_LONG",
+	[OP_WIDE]             = "OP_WIDE",
+	[OP_CLOSURE]          = "OP_CLOSURE",
+	[OP_PRINT]            = "OP_PRINT",
+	[OP_GET_INSTANCE]     = "OP_GET_INSTANCE",
+	[OP_ALLOC_TABLE]      = "OP_ALLOC_TABLE",
+	[OP_ALLOC_VECTOR]     = "OP_ALLOC_VECTOR",
+	[OP_ALLOC_2D_VECTOR]  = "OP_ALLOC_2D_VECTOR",
+	[OP_INIT_VECTOR]      = "OP_INIT_VECTOR",
+	[OP_INIT_2D_VECTOR]   = "OP_INIT_2D_VECTOR",
+	[OP_INIT_3D_VECTOR]   = "OP_INIT_3D_VECTOR",
+	[OP_GET_ACCESS]       = "OP_GET_ACCESS",
+	[OP_SET_ACCESS]       = "OP_SET_ACCESS",
+	[OP_POP]              = "OP_POP",
+	[OP_POPN]             = "OP_POPN",
+	[OP_RM]               = "OP_RM",
+	[OP_CLOSE_UPVAL]      = "OP_CLOSE_UPVAL",
+	[OP_LEN]              = "OP_LEN",
+	[OP_GET_PROP]         = "OP_GET_PROP",
+	[OP_SET_PROP]         = "OP_SET_PROP",
+	[OP_SET_FIELD]        = "OP_SET_FIELD",
+	[OP_GET_FIELD]        = "OP_GET_FIELD",
+	[OP_DELETE_VAL]       = "OP_DELETE_VAL",
+	[OP_INSERT_VAL]       = "OP_INSERT_VAL",
+	[OP_PUSH_VAL]         = "OP_PUSH_VAL",
+	[OP_POP_VAL]          = "OP_POP_VAL",
+	[OP_GET_METHOD]       = "OP_GET_METHOD",
+	[OP_ALLOC_INSTANCE]   = "OP_ALLOC_INSTANCE",
+	[OP_RST_CALLER]       = "OP_RST_CALLER",
+	[OP_GET_OBJ]          = "OP_GET_OBJ",
+	[OP_SET_OBJ]          = "OP_SET_OBJ",
+	[OP_EXPORT_MODULE]    = "OP_EXPORT_MODULE",
+	[OP_GLOBAL_DEF]       = "OP_GLOBAL_DEF",
+	[OP_GET_GLOBAL]       = "OP_GET_GLOBAL",
+	[OP_SET_GLOBAL]       = "OP_SET_GLOBAL",
+	[OP_SET_FUNC_VAR]     = "OP_SET_FUNC_VAR",
+	[OP_RESET_ARGC]       = "OP_RESET_ARGC",
+	[OP_GET_LOCAL]        = "OP_GET_LOCAL",
+	[OP_SET_LOCAL]        = "OP_SET_LOCAL",
+	[OP_SET_LOCAL_PARAM]  = "OP_SET_LOCAL_PARAM",
+	[OP_GET_UPVALUE]      = "OP_GET_UPVALUE",
+	[OP_SET_UPVALUE]      = "OP_SET_UPVALUE",
+	[OP_ADD_ASSIGN]       = "OP_ADD_ASSIGN",
+	[OP_SUB_ASSIGN]       = "OP_SUB_ASSIGN",
+	[OP_MUL_ASSIGN]       = "OP_MUL_ASSIGN",
+	[OP_DIV_ASSIGN]       = "OP_DIV_ASSIGN",
+	[OP_MOD_ASSIGN]       = "OP_MOD_ASSIGN",
+	[OP_AND_ASSIGN]       = "OP_AND_ASSIGN",
+	[OP__OR_ASSIGN]       = "OP__OR_ASSIGN",
+	[OP_CAST]             = "OP_CAST",
+	[OP_NEG]              = "OP_NEG",
+	[OP_INC]              = "OP_INC",
+	[OP_DEC]              = "OP_DEC",
+	[OP_ADD]              = "OP_ADD",
+	[OP_SUB]              = "OP_SUB",
+	[OP_MUL]              = "OP_MUL",
+	[OP_MOD]              = "OP_MOD",
+	[OP_DIV]              = "OP_DIV",
+	[OP_BIT_AND]          = "OP_BIT_AND",
+	[OP_BIT_OR]           = "OP_BIT_OR",
+	[OP_AND]              = "OP_AND",
+	[OP_OR]               = "OP_OR",
+	[OP_EQ]               = "OP_EQ",
+	[OP_NE]               = "OP_NE",
+	[OP_LT]               = "OP_LT",
+	[OP_LE]               = "OP_LE",
+	[OP_GT]               = "OP_GT",
+	[OP_GE]               = "OP_GE",
+	[OP_JMP_NIL]          = "OP_JMP_NIL",
+	[OP_JMP_NOT_NIL]      = "OP_JMP_NOT_NIL",
+	[OP_JMPL]             = "OP_JMPL",
+	[OP_JMPF]             = "OP_JMPF",
+	[OP_JMPT]             = "OP_JMPT",
+	[OP_JMP]              = "OP_JMP",
+	[OP_LOOP]             = "OP_LOOP",
+	[OP_FOR_PREP]         = "OP_FOR_PREP",
+	[OP_FOR_LOOP]         = "OP_FOR_LOOP",
+	[OP_SWITCH]           = "OP_SWITCH",
+	[OP_CALL]             = "OP_CALL",
+	[OP_TAIL_CALL]        = "OP_TAIL_CALL",
+	[OP_INVOKE]           = "OP_INVOKE",
+	[OP_TAIL_INVOKE]      = "OP_TAIL_INVOKE",
+	[OP_INIT]             = "OP_INIT",
+	[OP_CALL_NATIVE]      = "OP_CALL_NATIVE",
+	[OP_SQRT]             = "OP_SQRT",
+	[OP_ABS]              = "OP_ABS",
+	[OP_FLOOR]            = "OP_FLOOR",
+	[OP_MIN]              = "OP_MIN",
+	[OP_MAX]              = "OP_MAX",
+	[OP_POW]              = "OP_POW",
+	[OP_METHOD]           = "OP_METHOD",
+	[OP_TO_STR]           = "OP_TO_STR",
+	[OP_NOOP]             = "OP_NOOP",
+	[OP_RETURN]           = "OP_RETURN",
+};
+
+const char *opcode_name(uint8_t op)
+{
+	return (op < OP_COUNT && names[op]) ? names[op] : "OP_UNKNOWN";
+}
+
 static int byte_instruction(const char *name, chunk *chunk, int offset)
 {
 	uint8_t slot = chunk->ip[offset + 1];
@@ -8,6 +111,56 @@ static int byte_instruction(const char *name, chunk *chunk, int offset)
 	return offset + 2;
 }
 
+static int native_instruction(const char *name, chunk *chunk, int offset)
+{
+	uint8_t slot = chunk->ip[offset + 1];
+	uint8_t argc = chunk->ip[offset + 2];
+	printf("%-16s %4d (%d args)\n", name, slot, argc);
+	return offset + 3;
+}
+
+static int for_instruction(const char *name, int sign, chunk *c, int offset)
+{
+	uint8_t  slot  = c->ip[offset + 1];
+	uint8_t  flags = c->ip[offset + 2];
+	uint8_t  limit = c->ip[offset + 3];
+	uint16_t jump  = (uint16_t)((c->ip[offset + 4] << 8) | c->ip[offset + 5]);
+
+	printf(
+	    "%-16s %4d %s %s %d -> %d\n", name, slot, (flags & FOR_LE) ? "<=" : "<",
+	    (flags & FOR_LOCAL) ? "local" : "const", limit,
+	    offset + 6 + sign * jump
+	);
+	return offset + 6;
+}
+
+static int switch_instruction(const char *name, chunk *c, int offset)
+{
+	uint8_t  type = c->ip[offset + 1];
+	uint8_t  keys = c->ip[offset + 2];
+	uint16_t base = (uint16_t)((c->ip[offset + 3] << 8) | c->ip[offset + 4]);
+
+	printf(
+	    "%-16s %s keys %d, %d slots at %d\n", name,
+	    (type & SWITCH_STRING)   ? "string"
+	    : (type & SWITCH_SPARSE) ? "sparse"
+	                             : "dense",
+	    keys, c->cases.bytes[base], base
+	);
+	return offset + 5;
+}
+
+static int invoke_instruction(const char *name, chunk *c, int offset)
+{
+	uint8_t constant = c->ip[offset + 1];
+	uint8_t argc     = c->ip[offset + 2];
+
+	printf("%-16s %4d (%d args) '", name, constant, argc);
+	print(c->constants->as[constant]);
+	printf("\n");
+	return offset + 3;
+}
+
 static int simple_instruction(const char *name, int offset)
 {
 	printf("%s\n", name);
@@ -24,6 +177,92 @@ static int constant_instruction(const char *name, chunk *c, int offset)
 	return offset + 2;
 }
 
+static int captures(chunk *c, int offset, closure *clos)
+{
+	static const char *kinds[] = {"upvalue", "local", "copy"};
+
+	for (int j = 0; clos && j < clos->uargc; j++)
+	{
+		uint8_t kind  = c->ip[offset];
+		int     index = c->ip[offset + 1];
+
+		if (kind & CAPTURE_WIDE)
+			index = (index << 8) | c->ip[offset + 2];
+
+		printf(
+		    "%04d      |                     %s %d\n", offset,
+		    kinds[kind & 0x03], index
+		);
+		offset += (kind & CAPTURE_WIDE) ? 3 : 2;
+	}
+	return offset;
+}
+
+/* OP_CLOSURE carries the function's object slot ahead of the upvalue
+ * descriptors; OP_METHOD does not. */
+static int
+closure_instruction(const char *name, chunk *c, int offset, bool slot)
+{
+	uint8_t constant = c->ip[++offset];
+	printf("%-16s %4d ", name, constant);
+	print(c->constants->as[constant]);
+	offset += slot ? 2 : 1;
+
+	return captures(c, offset, CLOSURE(c->constants->as[constant]));
+}
+
+/* An object slot followed by the constant stored into it. */
+static int slot_instruction(const char *name, chunk *c, int offset)
+{
+	uint8_t slot     = c->ip[offset + 1];
+	uint8_t constant = c->ip[offset + 2];
+
+	printf("%-16s %4d %4d '", name, slot, constant);
+	print(c->constants->as[constant]);
+	printf("\n");
+	return offset + 3;
+}
+
+static int long_constant_instruction(const char *name, chunk *c, int offset)
+{
+	int constant = (c->ip[offset + 1] << 8) | c->ip[offset + 2];
+
+	printf("%-16s %4d '", name, constant);
+	print(c->constants->as[constant]);
+	printf("\n");
+	return offset + 3;
+}
+
+/* Prints the wrapped opcode by number followed by its widened operands. */
+static int wide_instruction(chunk *c, int offset)
+{
+	uint8_t op  = c->ip[offset + 1];
+	int     arg = (c->ip[offset + 2] << 8) | c->ip[offset + 3];
+
+	printf("%-16s %4d %5d", "OP_WIDE", op, arg);
+	offset += 4;
+
+	switch (op)
+	{
+	case OP_SET_OBJ:
+	case OP_CLOSURE:
+		printf(" %5d", (c->ip[offset] << 8) | c->ip[offset + 1]);
+		offset += 2;
+		break;
+	case OP_INVOKE:
+	case OP_TAIL_INVOKE:
+		printf(" (%d args)", c->ip[offset++]);
+		break;
+	default:
+		break;
+	}
+	printf("\n");
+
+	if (op == OP_CLOSURE || op == OP_METHOD)
+		offset = captures(c, offset, CLOSURE(c->constants->as[arg]));
+	return offset;
+}
+
 static int
 jump_instruction(const char *name, int sign, chunk *chunk, int offset)
 {
@@ -47,53 +286,32 @@ void disassemble_chunk(chunk *c, const char *name)
 int disassemble_instruction(chunk *c, int offset)
 {
 
-	printf("%d: %04d ", c->lines[offset], offset);
+	printf("%d: %04d ", chunk_line(c, offset, NULL), offset);
 
 	switch (c->ip[offset])
 	{
 	case OP_CONSTANT:
 		return constant_instruction("OP_CONSTANT", c, offset);
+	case OP_CONSTANT_LONG:
+		return long_constant_instruction("OP_CONSTANT_LONG", c, offset);
+	case OP_WIDE:
+		return wide_instruction(c, offset);
 	case OP_CLOSURE:
-	{
-		offset++;
-		uint8_t constant = c->ip[offset++];
-		printf("%-16s %4d ", "OP_CLOSURE", constant);
-		print(c->constants->as[constant]);
-
-		closure *clos = CLOSURE(c->constants->as[constant]);
-		if (!clos)
-			return offset;
-
-		for (int j = 0; j < clos->uargc; j++)
-		{
-			int isLocal = c->ip[offset++];
-			int index   = c->ip[offset++];
-			printf(
-			    "%04d      |                     %s %d\n", offset - 2,
-			    isLocal ? "local" : "upvalue", index
-			);
-		}
-
-		return offset;
-	}
+		return closure_instruction("OP_CLOSURE", c, offset, true);
 	case OP_ALLOC_INSTANCE:
 		return byte_instruction("OP_ALLOC_INSTANCE", c, offset);
-	case OP_INSTANCE:
-		return byte_instruction("OP_INSTANCE", c, offset);
 	case OP_GET_OBJ:
 		return byte_instruction("OP_GET_OBJ", c, offset);
 	case OP_SET_OBJ:
-		return byte_instruction("OP_SET_OBJ", c, offset);
+		return slot_instruction("OP_SET_OBJ", c, offset);
 	case OP_RESET_ARGC:
 		return simple_instruction("OP_RESET_ARGC", offset);
 	case OP_METHOD:
-		return constant_instruction("OP_METHOD", c, offset);
-	case OP_CLASS:
-		return constant_instruction("OP_CLASS", c, offset);
+		return closure_instruction("OP_METHOD", c, offset, false);
 	case OP_GET_INSTANCE:
 		return constant_instruction("OP_GET_INSTANCE", c, offset);
 	case OP_CLOSE_UPVAL:
-		return simple_instruction("OP_CLOSE_UPVAL", offset);
+		return byte_instruction("OP_CLOSE_UPVAL", c, offset);
 	case OP_GET_UPVALUE:
 		return byte_instruction("OP_GET_UPVALUE", c, offset);
 	case OP_SET_UPVALUE:
@@ -129,6 +347,10 @@ int disassemble_instruction(chunk *c, int offset)
 		return simple_instruction("OP_EQ", offset);
 	case OP_NE:
 		return simple_instruction("OP_NE", offset);
+	case OP_BIT_AND:
+		return simple_instruction("OP_BIT_AND", offset);
+	case OP_BIT_OR:
+		return simple_instruction("OP_BIT_OR", offset);
 	case OP_AND:
 		return simple_instruction("OP_AND", offset);
 	case OP_OR:
@@ -155,13 +377,15 @@ int disassemble_instruction(chunk *c, int offset)
 	case OP_INIT_2D_VECTOR:
 		return byte_instruction("OP_INIT_2D_VECTOR", c, offset);
 	case OP_RM:
-		return byte_instruction("OP_RM", c, offset);
+		return simple_instruction("OP_RM", offset);
 	case OP_GET_GLOBAL:
-		return simple_instruction("OP_GET_GLOBAL", offset);
+		return constant_instruction("OP_GET_GLOBAL", c, offset);
 	case OP_SET_GLOBAL:
-		return simple_instruction("OP_SET_GLOBAL", offset);
+		return constant_instruction("OP_SET_GLOBAL", c, offset);
 	case OP_GLOBAL_DEF:
-		return simple_instruction("OP_GLOBAL_DEF", offset);
+		return constant_instruction("OP_GLOBAL_DEF", c, offset);
+	case OP_SET_FUNC_VAR:
+		return constant_instruction("OP_SET_FUNC_VAR", c, offset);
 
 	case OP_JMP_NIL:
 		return jump_instruction("OP_JMP_NIL", 1, c, offset);
@@ -173,20 +397,48 @@ int disassemble_instruction(chunk *c, int offset)
 		return jump_instruction("OP_JMPT", 1, c, offset);
 	case OP_JMPL:
 		return jump_instruction("OP_JMPL", 1, c, offset);
+	case OP_SWITCH:
+		return switch_instruction("OP_SWITCH", c, offset);
 	case OP_JMP:
 		return jump_instruction("OP_JMP", 1, c, offset);
 	case OP_LOOP:
 		return jump_instruction("OP_LOOP", -1, c, offset);
+	case OP_FOR_PREP:
+		return for_instruction("OP_FOR_PREP", 1, c, offset);
+	case OP_FOR_LOOP:
+		return for_instruction("OP_FOR_LOOP", -1, c, offset);
 	case OP_POPN:
-		return simple_instruction("OP_POPN", offset);
+		return byte_instruction("OP_POPN", c, offset);
 	case OP_POP:
 		return simple_instruction("OP_POP", offset);
 	case OP_CALL:
 		return byte_instruction("OP_CALL", c, offset);
+	case OP_INIT:
+		return byte_instruction("OP_INIT", c, offset);
+	case OP_INVOKE:
+		return invoke_instruction("OP_INVOKE", c, offset);
+	case OP_TAIL_CALL:
+		return byte_instruction("OP_TAIL_CALL", c, offset);
+	case OP_TAIL_INVOKE:
+		return invoke_instruction("OP_TAIL_INVOKE", c, offset);
+	case OP_CALL_NATIVE:
+		return native_instruction("OP_CALL_NATIVE", c, offset);
+	case OP_SQRT:
+		return simple_instruction("OP_SQRT", offset);
+	case OP_ABS:
+		return simple_instruction("OP_ABS", offset);
+	case OP_FLOOR:
+		return simple_instruction("OP_FLOOR", offset);
+	case OP_MIN:
+		return simple_instruction("OP_MIN", offset);
+	case OP_MAX:
+		return simple_instruction("OP_MAX", offset);
+	case OP_POW:
+		return simple_instruction("OP_POW", offset);
 	case OP_CAST:
 		return byte_instruction("OP_CAST", c, offset);
 	case OP_TO_STR:
-		return byte_instruction("OP_TO_STR", c, offset);
+		return simple_instruction("OP_TO_STR", offset);
 	case OP_PRINT:
 		return simple_instruction("OP_PRINT", offset);
 	case OP_RETURN:
@@ -196,8 +448,6 @@ int disassemble_instruction(chunk *c, int offset)
 	case OP_SET_PROP:
 		return byte_instruction("OP_SET_PROP", c, offset);
 
-	case OP_THIS:
-		return simple_instruction("OP_THIS", offset);
 	case OP_GET_ACCESS:
 		return simple_instruction("OP_GET_ACCESS", offset);
 	case OP_SET_ACCESS:
@@ -7,10 +7,10 @@
 static element cadd(int argc, element *argv)
 {
 	double a = 0.0, b = 0.0;
-	if (argc > 0 && argv[0].type == T_NUM)
-		a = argv[0].val.Num;
-	if (argc > 1 && argv[1].type == T_NUM)
-		b = argv[1].val.Num;
+	if (argc > 0 && IS_NUM(argv[0]))
+		a = NUM(argv[0]);
+	if (argc > 1 && IS_NUM(argv[1]))
+		b = NUM(argv[1]);
 	return Num(a + b);
 }
 
@@ -20,10 +20,49 @@ int main(void)
 
 	yk_register_native("cadd", cadd);
 
-	/* Run a small script that uses the registered native */
-	const char *src = "print(cadd(2, 3));";
+	/* Compile once; the top level only defines functions. */
+	const char *src = "sr scale(x) { return cadd(x, x); }"
+	                  "sr total(v) {"
+	                  "    var sum = 0;"
+	                  "    for (var i = 0; i < v.len; i++)"
+	                  "        sum = sum + v[i];"
+	                  "    return sum;"
+	                  "}";
 
-	interpret(src);
+	if (yk_load(src) != 0)
+		return 1;
+
+	closure *scale = yk_lookup("scale");
+
+	if (!scale)
+		return 1;
+
+	/* Each call reuses the compiled closure: no parsing, no top level. */
+	for (int i = 0; i < 5; i++)
+	{
+		element arg = Num(i);
+		element res;
+
+		if (yk_call(scale, 1, &arg, &res) != 0)
+			break;
+
+		printf("scale(%d) = %g\n", i, NUM(res));
+	}
+
+	/* Hand a host array to the script without copying it. The host keeps
+	 * ownership, so no release callback is passed. */
+	double  samples[] = {1.5, 2.5, 3.0, 4.0};
+	element vec       = yk_wrap_doubles(samples, 4, NULL, NULL);
+	element sum;
+
+	if (yk_call(yk_lookup("total"), 1, &vec, &sum) == 0)
+		printf("total = %g\n", NUM(sum));
+
+	/* ... and read the vector's storage back in place. */
+	size_t  count = 0;
+	double *view  = yk_borrow_doubles(vec, &count);
+	printf("borrowed %zu values, shared: %s\n", count,
+	       view == samples ? "yes" : "no");
 
 	yk_vm_free();
 	return 0;
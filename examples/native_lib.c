@@ -0,0 +1,36 @@
+/* Example native extension. `make` builds it as a shared library, or by
+ * hand from the repository root:
+ *
+ *	cc -shared -fPIC -Iincludes -o examples/libgeom.so examples/native_lib.c
+ *
+ * and load it from a script with `import "libgeom.so";` (the path is
+ * relative to the script). The host's `ykes` must be linked with
+ * `-rdynamic` so the library can use the runtime's constructors.
+ */
+#include "ffi.h"
+#include "object.h"
+#include <math.h>
+
+static double num(element el)
+{
+	return IS_NUM(el) ? NUM(el) : 0.0;
+}
+
+static element hypot_native(int argc, element *argv)
+{
+	(void)argc;
+	return Num(hypot(num(argv[0]), num(argv[1])));
+}
+
+static element lerp_native(int argc, element *argv)
+{
+	(void)argc;
+	double a = num(argv[0]), b = num(argv[1]), t = num(argv[2]);
+	return Num(a + (b - a) * t);
+}
+
+const yk_native_def yk_natives[] = {
+    {"hypot", hypot_native, 2},
+    {"lerp", lerp_native, 3},
+    {NULL, NULL, 0},
+};
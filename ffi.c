@@ -5,6 +5,7 @@
 #include "table.h"
 #include "virtual_machine.h"
 
+#include <dlfcn.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -31,6 +32,7 @@ int yk_register_native(const char *name, NativeFn fn)
 		machine.stack.obj = GROW_STACK(NULL, INIT_SIZE);
 
 	/* Ensure there's space for the new native */
+	machine.stack.obj->count = machine.count.native;
 	machine.stack.obj =
 	    GROW_STACK(&machine.stack.obj, machine.count.native + 1);
 
@@ -51,6 +53,131 @@ int yk_register_native(const char *name, NativeFn fn)
 	return (int)(machine.count.native++);
 }
 
+int yk_load(const char *src)
+{
+	if (!src)
+		return 1;
+
+	return (interpret(src) != INTERPRET_SUCCESS) ? 1 : 0;
+}
+
+closure *yk_lookup(const char *name)
+{
+	return name ? find_function(name) : NULL;
+}
+
+int yk_call(closure *fn, int argc, element *argv, element *result)
+{
+	if (!fn || argc < 0 || argc > UINT8_MAX)
+		return 1;
+
+	return (call_function(fn, (uint8_t)argc, argv, result) !=
+	        INTERPRET_SUCCESS)
+	           ? 1
+	           : 0;
+}
+
+/* Number vectors store `value`s, which must alias plain doubles for the
+ * wrap and borrow calls to hand storage across without copying. */
+_Static_assert(sizeof(value) == sizeof(double), "value must alias double");
+
+element
+yk_wrap_doubles(double *data, size_t count, ReleaseFn release, void *ctx)
+{
+	vector *v   = NULL;
+	v           = ALLOC(sizeof(vector));
+	v->count    = (int)count;
+	v->len      = (int)count;
+	v->type     = T_NUM;
+	v->borrowed = 1;
+	v->of       = (value *)data;
+	v->release  = release;
+	v->ctx      = ctx;
+
+	return GEN(v, T_VECTOR);
+}
+
+element yk_wrap_bytes(char *data, size_t len, ReleaseFn release, void *ctx)
+{
+	_string *s  = NULL;
+	s           = ALLOC(sizeof(_string));
+	s->String   = data;
+	s->len      = (int)len;
+	s->borrowed = BORROW_BYTES;
+	s->release  = release;
+	s->ctx      = ctx;
+
+	return GEN(s, T_STR);
+}
+
+double *yk_borrow_doubles(element el, size_t *count)
+{
+	if (el.type != T_VECTOR || VECTOR(el)->type != T_NUM)
+		return NULL;
+
+	if (count)
+		*count = (size_t)VECTOR(el)->count;
+	return (double *)VECTOR(el)->of;
+}
+
+const char *yk_borrow_bytes(element el, size_t *len)
+{
+	if (el.type != T_STR)
+		return NULL;
+
+	if (len)
+		*len = (size_t)STR(el)->len;
+	return STR(el)->String;
+}
+
+/* Libraries stay open for the life of the VM: their natives are reachable
+ * from the object stack until it is freed. Each script installs the natives
+ * it imports into its own object slots, so nothing here is keyed by slot. */
+static void *libs[YK_MAX_LIBS];
+static int   lib_count = 0;
+
+int yk_open_library(
+    const char *path, const yk_native_def **defs, const char **err_out
+)
+{
+	if (lib_count == YK_MAX_LIBS)
+	{
+		*err_out = "Too many native libraries loaded.";
+		return 1;
+	}
+
+	void *lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+
+	if (!lib)
+	{
+		*err_out = "Could not open native library.";
+		return 1;
+	}
+
+	*defs = dlsym(lib, "yk_natives");
+
+	if (!*defs)
+	{
+		dlclose(lib);
+		*err_out = "Native library does not export `yk_natives`.";
+		return 1;
+	}
+
+	libs[lib_count++] = lib;
+	return 0;
+}
+
+int yk_native_arity(uint8_t slot)
+{
+	return (slot < builtin_count) ? builtin_natives[slot].arity : YK_VARIADIC;
+}
+
+void yk_free_libraries(void)
+{
+	while (lib_count > 0)
+		dlclose(libs[--lib_count]);
+}
+
 static char *read_entire_file(const char *path)
 {
 	if (!path)
@@ -3,7 +3,15 @@
 #define _CHUNK_H
 #include "stack.h"
 
+/* Longest encoding of one line run: a header byte and three varints. */
+#define LINE_RUN_MAX 16
+
+#define ZIGZAG(n)   (((uint32_t)(n) << 1) ^ (uint32_t)((n) >> 31))
+#define UNZIGZAG(n) ((int)((n) >> 1) ^ -(int)((n) & 1))
+
 function *_function(_key *name);
-void      write_chunk(chunk *ch, uint8_t byte, uint16_t line);
+void      write_chunk(chunk *ch, uint8_t byte, int line, int col);
+int       chunk_line(chunk *c, int offset, int *col);
+int       reserve_cases(chunk *c, int n);
 
 #endif
@@ -3,9 +3,11 @@
 #include "object_memory.h"
 #include "scanner.h"
 
-#define LOCAL_COUNT 255
-#define CALL_COUNT  255
+#define LOCAL_COUNT   1024
+#define UPVALUE_COUNT 255
+#define CAPTURE_COUNT 255
 #define CLASS_COUNT 50
+#define CASE_COUNT  255
 #define CWD_MAX     512
 
 #define INSTANCE_SET 0x01 /* 0000 0001 */
@@ -22,6 +24,8 @@ typedef enum
 	PREC_ASSIGNMENT, // =
 	PREC_OR,         // or
 	PREC_AND,        // and
+	PREC_BIT_OR,     // |
+	PREC_BIT_AND,    // &
 	PREC_EQUALITY,   // == !=
 	PREC_COMPARISON, // < > <= >=
 	PREC_TERM,       // + -
@@ -44,6 +48,7 @@ typedef enum
 typedef struct parser         parser;
 typedef struct local          local;
 typedef struct upvalue        upvalue;
+typedef struct capture        capture;
 typedef struct compiler       compiler;
 typedef struct class_compiler class_compiler;
 typedef void (*parse_fn)(compiler *);
@@ -59,7 +64,8 @@ struct parser
 {
 	token       cur;
 	token       pre;
-	uint8_t     flag;
+	uint8_t     flag;  /* panic mode, cleared by synchronize() */
+	bool        error; /* any error reported, fails the compile */
 	const char *current_file;
 };
 
@@ -68,39 +74,50 @@ struct local
 	_key    name;
 	uint8_t depth;
 	bool    captured;
+	bool    assigned;
 };
 
 struct upvalue
 {
-	uint8_t index;
-	bool    islocal;
+	uint16_t index;
+	bool     islocal;
+};
+
+/* A closure descriptor capturing `local` by reference, still waiting to
+ * learn whether the local is ever reassigned. */
+struct capture
+{
+	uint16_t local;
+	int      offset;
 };
 
 struct class_compiler
 {
 	class_compiler *enclosing;
-	uint8_t         index;
+	uint16_t        index;
 	_key            name;
 };
 
 struct counter
 {
-	uint8_t local;
-	uint8_t scope;
-	uint8_t upvalue;
-	uint8_t obj;
+	uint16_t local;
+	uint8_t  scope;
+	uint8_t  upvalue;
+	uint16_t obj;
+	uint8_t  capture;
 };
 
 struct current
 {
-	uint8_t index;
-	uint8_t set;
-	uint8_t get;
+	uint16_t index;
+	uint8_t  set;
+	uint8_t  get;
 };
 
 struct hash_ref
 {
 	int init;
+	int this;
 	int len;
 	int push;
 	int pop;
@@ -114,13 +131,18 @@ struct meta
 	uint8_t     flags;
 	compiler_t  type;
 	const char *cwd;
+	int         call; /* offset of the last OP_CALL / OP_INVOKE */
 };
 
 struct compiler_stack
 {
-	class *class[CALL_COUNT];
-	local   local[LOCAL_COUNT];
-	upvalue upvalue[LOCAL_COUNT];
+	element *object; /* what OP_SET_OBJ installs, by slot; base compiler only */
+	int      objects;
+	int     *literal; /* constant index + 1 by literal hash, 0 if empty */
+	int      literals;
+	local    local[LOCAL_COUNT];
+	upvalue  upvalue[UPVALUE_COUNT];
+	capture  capture[CAPTURE_COUNT];
 };
 
 struct compiler
@@ -154,6 +176,8 @@ static void advance_compiler(parser *parser);
 
 static void declaration(compiler *c);
 static void call(compiler *c);
+static void call_native(compiler *c, int slot);
+static void shadow_native(compiler *c, _key *ar);
 
 static int argument_list(compiler *c);
 
@@ -173,6 +197,7 @@ static void print_statement(compiler *c);
 
 static void begin_scope(compiler *c);
 static void end_scope(compiler *c);
+static void resolve_captures(compiler *c, int from);
 
 static void parse_block(compiler *c);
 static void block(compiler *c);
@@ -184,6 +209,7 @@ static int  emit_jump(compiler *c, int byte);
 static void patch_jump(compiler *c, int byte);
 
 static void for_statement(compiler *c);
+static bool counted_loop(compiler *c);
 static void while_statement(compiler *c);
 
 static void rm_statement(compiler *c);
@@ -193,7 +219,10 @@ static void consume_elif(compiler *c);
 static void consume_switch(compiler *c);
 
 static void switch_statement(compiler *c);
-static void case_statement(compiler *c);
+static bool case_statement(compiler *c);
+static bool case_body(compiler *c);
+static void default_case(compiler *c);
+static bool jump_table(compiler *c);
 
 static void if_statement(compiler *c);
 static void elif_statement(compiler *c);
@@ -201,6 +230,7 @@ static void ternary_statement(compiler *c);
 static void null_coalescing_statement(compiler *c);
 
 static void return_statement(compiler *c);
+static void tail_call(compiler *c);
 
 static void default_expression(compiler *c);
 static void expression(compiler *c);
@@ -229,10 +259,17 @@ static void error_at(Token t, parser *parser, const char *err);
 
 static void emit_byte(compiler *c, uint8_t byte);
 static void emit_bytes(compiler *c, uint8_t b1, uint8_t b2);
+static void emit_short(compiler *c, int arg);
+static void emit_arg(compiler *c, uint8_t op, int arg);
+static void emit_args(compiler *c, uint8_t op, int a, int b);
 static void emit_constant(compiler *c, element ar);
+static int  make_constant(compiler *c, element el);
+static int  key_constant(compiler *c, _key *ar);
 static void emit_return(compiler *c);
 
-static void  num(compiler *c);
+static element number(token *t);
+static void    num(compiler *c);
+static char    char_literal(token *t);
 static void  ch(compiler *c);
 static void  boolean(compiler *c);
 static void  str(compiler *c);
@@ -244,6 +281,8 @@ static void _table(compiler *c);
 static int resolve_local(compiler *c, _key *name);
 static int resolve_upvalue(compiler *c, _key *name);
 static int add_upvalue(compiler *c, int upvalue, bool t);
+static void emit_captures(compiler *c, compiler *inner);
+static void assign(compiler *c, uint8_t set, int index);
 
 static void parse_native_var_arg(compiler *c);
 
@@ -258,6 +297,8 @@ static void id(compiler *c);
 static bool idcmp(_key *a, _key *b);
 static void declare_var(compiler *c, _key *ar);
 static void add_local(compiler *c, _key *ar);
+static int  new_object(compiler *c);
+static void reserve_object(compiler *base, int slot);
 
 static void _array(compiler *c);
 static void _access(compiler *c);
@@ -298,6 +339,8 @@ static PRule rules[] = {
     [TOKEN_SC_OR]              = {NULL,                 _or,                       PREC_OR        },
     [TOKEN_OP_AND]             = {NULL,                 binary,                    PREC_AND       },
     [TOKEN_OP_OR]              = {NULL,                 binary,                    PREC_OR        },
+    [TOKEN_LG_AND]             = {NULL,                 binary,                    PREC_BIT_AND   },
+    [TOKEN_LG_OR]              = {NULL,                 binary,                    PREC_BIT_OR    },
     [TOKEN_FALSE]              = {boolean,              NULL,                      PREC_NONE      },
     [TOKEN_TRUE]               = {boolean,              NULL,                      PREC_NONE      },
     [TOKEN_EACH]               = {NULL,                 NULL,                      PREC_NONE      },
@@ -1,9 +1,11 @@
 #ifndef _DEBUG_H
 #define _DEBUG_H
 
-#include "stack.h"
+#include "chunk.h"
 
 void disassemble_chunk(chunk *c, const char *str);
 int  disassemble_instruction(chunk *c, int offset);
 
+const char *opcode_name(uint8_t op);
+
 #endif
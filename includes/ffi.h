@@ -3,8 +3,35 @@
 
 #include "object_type.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
 /* Minimal embedding / FFI API for Ykes runtime */
 
+/* Arity of a native that accepts any number of arguments. */
+#define YK_VARIADIC -1
+
+/* Most shared libraries a single VM can have loaded at once. */
+#define YK_MAX_LIBS 32
+
+/* One entry of a native registration table. A shared library imported with
+ * `import "lib.so";` exports such an array as `yk_natives`, terminated by an
+ * entry whose `name` is NULL.
+ */
+typedef struct yk_native_def yk_native_def;
+
+struct yk_native_def
+{
+	const char *name;
+	NativeFn    fn;
+	int         arity;
+};
+
+/* Natives every script can call, defined in native.c. Their object slots
+ * follow table order. */
+extern const yk_native_def builtin_natives[];
+extern const int           builtin_count;
+
 /* Initialize and shutdown the VM */
 void yk_vm_init(void);
 void yk_vm_free(void);
@@ -21,6 +48,63 @@ int yk_register_native(const char *name, NativeFn fn);
  */
 int yk_load_module(const char *path, char **err_out);
 
+/* Compile `src` and run its top level once. Its functions stay callable
+ * through `yk_lookup` / `yk_call` without being parsed again.
+ * Returns 0 on success, non-zero on a compile or runtime error.
+ */
+int yk_load(const char *src);
+
+/* Find a top-level function of the most recently loaded script by name.
+ * Returns NULL if there is none. The closure stays valid until
+ * `yk_vm_free`.
+ */
+closure *yk_lookup(const char *name);
+
+/* Call `fn` with `argc` arguments from `argv` and store its return value
+ * in `*result` (may be NULL). Must not be called from inside a native
+ * while the VM is running. Returns 0 on success, non-zero on a runtime
+ * error, in which case `*result` is null.
+ */
+int yk_call(closure *fn, int argc, element *argv, element *result);
+
+/* Wrap `count` doubles as a number vector without copying them.
+ * With a `release` callback the VM takes ownership and calls
+ * `release(data, ctx)` once it stops referencing the buffer: when the
+ * vector is freed or first grows past `count`. Without one the caller keeps
+ * ownership and must keep `data` alive while the script can reach it.
+ */
+element yk_wrap_doubles(
+    double *data, size_t count, ReleaseFn release, void *ctx
+);
+
+/* Wrap `len` bytes as a string without copying them, with the same
+ * ownership rules as `yk_wrap_doubles`. `data[len]` must be a NUL byte.
+ */
+element yk_wrap_bytes(char *data, size_t len, ReleaseFn release, void *ctx);
+
+/* Borrow the storage behind a number vector or string. The pointer is only
+ * valid until the script next grows or frees the object. Returns NULL if
+ * `el` has another type.
+ */
+double     *yk_borrow_doubles(element el, size_t *count);
+const char *yk_borrow_bytes(element el, size_t *len);
+
+/* Open the shared library at `path` and point `*defs` at its `yk_natives`
+ * table. The library stays loaded until `yk_free_libraries`. Returns 0 on
+ * success and sets `*err_out` to a static message otherwise.
+ */
+int yk_open_library(
+    const char *path, const yk_native_def **defs, const char **err_out
+);
+
+/* Declared arity of the builtin native in object slot `slot`, or
+ * YK_VARIADIC if it takes any number of arguments.
+ */
+int yk_native_arity(uint8_t slot);
+
+/* Close every loaded library. */
+void yk_free_libraries(void);
+
 /* Record an exported identifier while compiling/executing a module.
  * The compiler should call this when it encounters an `export` declaration
  * for a top-level identifier. The recorded exports are used by
@@ -0,0 +1,25 @@
+#ifndef _IO_H
+#define _IO_H
+
+#include "object.h"
+
+/* Pages of a view's private mapping that lie behind the read cursor are
+ * dropped once at least this many have accumulated. */
+#define VIEW_RELEASE 64
+
+/* Bytes a file handle accumulates before writing them out. */
+#define HANDLE_BUFFER 65536
+
+element map_file(const char *path);
+element view_line(view *v);
+element view_block(view *v, size_t size);
+void    free_view(view **v);
+
+element open_handle(const char *path, const char *mode);
+element write_handle(handle *h, _string *data);
+element read_handle(handle *h, off_t offset, size_t size);
+bool    flush_handle(handle *h);
+void    close_handle(handle *h);
+void    free_handles(void);
+
+#endif
@@ -1,11 +1,17 @@
 #ifndef _NATIVE_H
 #define _NATIVE_H
 
+#include "ffi.h"
 #include "object_math.h"
 
 void    define_natives(stack **stk);
 element clock_native(int argc, element *argv);
 element file_native(int argc, element *argv);
 element square_native(int argc, element *argv);
+element abs_native(int argc, element *argv);
+element floor_native(int argc, element *argv);
+element min_native(int argc, element *argv);
+element max_native(int argc, element *argv);
+element pow_native(int argc, element *argv);
 
 #endif
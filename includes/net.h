@@ -0,0 +1,13 @@
+#ifndef _NET_H
+#define _NET_H
+
+#include "object.h"
+
+#define NET_MAX_CONN 1024
+#define NET_BUFFER   4096
+#define NET_EVENTS   64
+
+element net_native(int argc, element *argv);
+void    free_net(void);
+
+#endif
@@ -21,6 +21,7 @@ element StringCpy(const char *str, size_t size);
 element String(const char *str, size_t size);
 element Char(char ch);
 element Num(double Num);
+element Int(Long Int);
 element NumType(double Num, obj_t type);
 element Bool(bool boolean);
 element Null(void);
@@ -16,12 +16,19 @@ element _gt(element *a, element *b);
 element _ge(element *a, element *b);
 element _or(element *a, element *b);
 element _and(element *a, element *b);
+element _bit_and(element *a, element *b);
+element _bit_or(element *a, element *b);
 
 element _cast(element *a, cast_t type);
 element _to_str(element *a);
 element _inc(element *b);
 element _dec(element *b);
 element _sqr(element *a);
+element _abs(element *a);
+element _floor(element *a);
+element _min(element *a, element *b);
+element _max(element *a, element *b);
+element _pow(element *a, element *b);
 element _len(element *a);
 
 #endif
@@ -8,6 +8,9 @@
 #define INIT_SIZE  16
 #define MIN_SIZE   8
 
+/* Bytes in each block of the closure pool. */
+#define POOL_BLOCK 4096
+
 #define GROW_CAPACITY(capacity)                                                \
 	((capacity) < MIN_SIZE ? MIN_SIZE : capacity * INC)
 
@@ -23,8 +26,10 @@ _2d_vector *_2d_vector_(size_t size, obj_t type);
 _3d_vector *_3d_vector_(size_t size, obj_t type);
 
 upval  **upvals(size_t size);
-upval   *_upval(element closed, uint8_t index);
+upval   *_upval(element *location);
 closure *_closure(function *func);
+closure *pool_closure(function *func);
+void     free_pool(void);
 
 native   *_native(NativeFn native, _key *ar);
 class    *_class(_key *name);
@@ -33,6 +38,7 @@ instance *_instance(class *c);
 void free_key(_key **s);
 void free_str(_string **s);
 void free_vector(vector **v);
+void free_values(vector *v);
 void free_2d_vector(_2d_vector **v);
 void free_3d_vector(_3d_vector **v);
 void free_table(table **t);
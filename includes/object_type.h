@@ -10,19 +10,21 @@ typedef struct function       function;
 typedef struct closure        closure;
 typedef struct upval          upval;
 typedef struct generic_vector generic_vector;
+typedef struct line_table     line_table;
 typedef struct buffer         buffer;
 typedef struct native         native;
 typedef struct element        element;
 typedef struct stack          stack;
-typedef struct init_table     init_table;
-typedef struct field_stack    field_stack;
 typedef struct _string        _string;
+typedef struct view           view;
+typedef struct handle         handle;
 
 typedef struct class class;
 typedef struct table    table;
 typedef struct record   record;
 typedef struct instance instance;
 typedef element (*NativeFn)(int argc, element *argv);
+typedef void (*ReleaseFn)(void *data, void *ctx);
 typedef struct _key _key;
 
 #endif
@@ -20,6 +20,16 @@
 #define STACK(el)      ((stack *)(el.obj))
 #define UPVAL(el)      ((upval *)(el.obj))
 #define STR(el)        ((_string *)el.obj)
+#define VIEW(el)       ((view *)(el.obj))
+#define HANDLE(el)     ((handle *)(el.obj))
+
+#define IS_NUM(el) (el.type == T_NUM || el.type == T_INT)
+#define NUM(el)    ((el.type == T_INT) ? (double)el.val.Int : el.val.Num)
+
+/* _string.borrowed: only the bytes belong to someone else, or the header
+ * does too, as with a reusable slice the VM hands out. */
+#define BORROW_BYTES 1
+#define BORROW_ALL   2
 
 typedef enum
 {
@@ -38,6 +48,7 @@ typedef enum
 {
 
 	T_NUM,
+	T_INT,
 	T_CHAR,
 	T_STR,
 	T_BOOL,
@@ -59,6 +70,8 @@ typedef enum
 	T_STACK,
 	T_TABLE,
 	T_MODULE,
+	T_VIEW,
+	T_FILE,
 	T_NULL
 } obj_t;
 
@@ -70,23 +83,50 @@ struct _key
 
 struct _string
 {
-	int   len;
-	char *String;
+	int       len;
+	uint8_t   borrowed;
+	char     *String;
+	ReleaseFn release;
+	void     *ctx;
+};
+
+struct view
+{
+	char    *bytes;
+	size_t   len;
+	size_t   pos;
+	size_t   released;
+	char    *term;
+	char     held;
+	char    *tail;
+	_string *slice;
+};
+
+struct handle
+{
+	int     fd;
+	char   *buf;
+	size_t  count;
+	handle *next;
 };
 
 union value
 {
-	double Num;
-	char   Char;
-	bool   Bool;
+	double    Num;
+	long long Int;
+	char      Char;
+	bool      Bool;
 };
 
 struct vector
 {
-	int    count;
-	int    len;
-	obj_t  type;
-	value *of;
+	int       count;
+	int       len;
+	obj_t     type;
+	uint8_t   borrowed;
+	value    *of;
+	ReleaseFn release;
+	void     *ctx;
 };
 struct _2d_vector
 {
@@ -117,23 +157,40 @@ struct generic_vector
 	uint16_t  len;
 };
 
+/* Source positions as a run per change of line or column. Each run is
+ * encoded relative to the one before it: a single byte holding the offset
+ * delta (< 16) and line delta (< 8) when both are small, otherwise 0x80
+ * followed by both as varints, then the column delta as a zigzag varint.
+ * `offset`, `line` and `col` are the start of the last run. */
+struct line_table
+{
+	uint8_t *bytes;
+	int      count;
+	int      len;
+	int      offset;
+	int      line;
+	int      col;
+};
+
 struct chunk
 {
 	int            count;
 	int            len;
 	uint8_t       *ip;
-	uint16_t      *lines;
+	line_table     lines;
 	generic_vector cases;
 	stack         *constants;
+	uint64_t      *hits;   /* executions by offset, kept by --count */
+	uint64_t      *cycles; /* cycles spent by offset, likewise */
 };
 
 struct function
 {
-	uint8_t arity;
-	uint8_t uargc;
-	uint8_t objc;
-	_key   *name;
-	chunk   ch;
+	uint8_t  arity;
+	uint8_t  uargc;
+	uint16_t objc;
+	_key    *name;
+	chunk    ch;
 };
 
 struct closure
@@ -141,11 +198,12 @@ struct closure
 	function *func;
 	upval   **upvals;
 	uint8_t   uargc;
+	uint8_t   pooled;
 };
 
 struct native
 {
-	uint8_t  arity;
+	int      arity;
 	_key    *name;
 	NativeFn fn;
 };
@@ -161,11 +219,13 @@ struct element
 	};
 };
 
+/* `location` points at the captured stack slot while the upvalue is open
+ * and at `closed` once the slot goes out of scope. */
 struct upval
 {
-	uint8_t index;
-	element closed;
-	upval  *next;
+	element *location;
+	element  closed;
+	upval   *next;
 };
 struct class
 {
@@ -182,8 +242,8 @@ struct instance
 
 struct stack
 {
-	uint16_t count;
-	uint16_t len;
+	int      count;
+	int      len;
 	element *as;
 };
 
@@ -201,17 +261,4 @@ struct table
 	record  *records;
 };
 
-struct init_table
-{
-	uint8_t init;
-	table  *fields;
-};
-
-struct field_stack
-{
-	uint8_t     count;
-	uint8_t     len;
-	init_table *fields;
-};
-
 #endif
@@ -4,10 +4,11 @@
 typedef enum
 {
 	OP_CONSTANT,
+	OP_CONSTANT_LONG,
+	OP_WIDE,
 	OP_CLOSURE,
 	OP_PRINT,
 
-	OP_CLASS,
 	OP_GET_INSTANCE,
 	OP_ALLOC_TABLE,
 	OP_ALLOC_VECTOR,
@@ -15,7 +16,6 @@ typedef enum
 	OP_INIT_VECTOR,
 	OP_INIT_2D_VECTOR,
 	OP_INIT_3D_VECTOR,
-	OP_THIS,
 	OP_GET_ACCESS,
 	OP_SET_ACCESS,
 
@@ -97,14 +97,48 @@ typedef enum
 	OP_JMPT,
 	OP_JMP,
 	OP_LOOP,
+	OP_FOR_PREP,
+	OP_FOR_LOOP,
+	OP_SWITCH,
 
 	OP_CALL,
-	OP_INSTANCE,
+	OP_TAIL_CALL,
+	OP_INVOKE,
+	OP_TAIL_INVOKE,
+	OP_INIT,
+	OP_CALL_NATIVE,
+
+	OP_SQRT,
+	OP_ABS,
+	OP_FLOOR,
+	OP_MIN,
+	OP_MAX,
+	OP_POW,
 	OP_METHOD,
 	OP_TO_STR,
 
 	OP_NOOP,
 	OP_RETURN,
+
+	OP_COUNT /* number of opcodes */
 } opcode_t;
 
+/* Operand flags of OP_FOR_PREP / OP_FOR_LOOP. */
+#define FOR_LE    0x01
+#define FOR_LOCAL 0x02
+
+/* How OP_CLOSURE / OP_METHOD fill each upvalue: share the enclosing
+ * closure's upvalue, capture a local by reference, or copy a local that is
+ * never reassigned. */
+#define CAPTURE_UPVALUE 0x00
+#define CAPTURE_LOCAL   0x01
+#define CAPTURE_COPY    0x02
+#define CAPTURE_WIDE    0x04 /* or-ed in when the index takes two bytes */
+
+/* Table kinds of OP_SWITCH. */
+#define SWITCH_DENSE  0x00
+#define SWITCH_SPARSE 0x01
+#define SWITCH_STRING 0x02
+#define SWITCH_CHAR   0x04
+
 #endif
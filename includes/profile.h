@@ -0,0 +1,32 @@
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include "virtual_machine.h"
+
+#include <signal.h>
+
+/* Microseconds of CPU time between samples. */
+#define PROFILE_INTERVAL 1000
+
+/* Innermost frames kept per sample, and the longest folded stack. */
+#define PROFILE_DEPTH 128
+#define PROFILE_STACK 4096
+
+/* Opcode pairs listed by the --count report. */
+#define COUNT_PAIRS 20
+
+/* Set by SIGPROF; run() takes the sample at its next safepoint. */
+extern volatile sig_atomic_t profile_pending;
+
+/* Set by --count; run() counts every instruction it dispatches. */
+extern bool counting;
+
+void start_profile(const char *path);
+void profile_sample(uint8_t *ip);
+void stop_profile(void);
+
+void start_count(void);
+void count_instruction(function *f, uint8_t *ip);
+void stop_count(void);
+
+#endif
@@ -9,11 +9,8 @@ void     push(stack **s, element e);
 element *pop(stack **s);
 void     popn(stack **s, int ival);
 
-field_stack *_fstack(void);
-field_stack *realloc_field_stack(field_stack **f);
-void         free_field_stack(field_stack **f);
-
-init_table pop_itab(field_stack **f);
-void       push_itab(field_stack **f, uint8_t init, table *field);
+stack *_vstack(size_t size);
+void   free_vstack(stack **s);
+bool   vstack_guard(stack *s, void *addr);
 
 #endif
@@ -11,6 +11,8 @@
 
 void    write_table(table *t, _key *key, element b);
 element find_entry(table **t, _key *key);
+element find_text(table *t, _key *key);
+element *find_ref(table *t, _key *key);
 table  *alloc_table(size_t size);
 table  *realloc_table(table **t, size_t size);
 table  *copy_table(table *t);
@@ -5,7 +5,18 @@
 #include "table.h"
 #include <limits.h>
 
-#define FRAMES_MAX 500
+/* Default limit on call depth; see set_frame_limit(). */
+#define FRAMES_MAX (1 << 16)
+
+/* A backtrace prints this many of the innermost and of the outermost
+ * frames, and counts the rest. */
+#define TRACE_FRAMES 10
+
+/* Call frames are allocated this many at a time. */
+#define FRAME_SEGMENT 64
+
+/* Elements reserved for the value stack; see _vstack(). */
+#define STACK_MAX (1 << 20)
 
 typedef enum
 {
@@ -15,7 +26,8 @@ typedef enum
 
 } Interpretation;
 
-typedef struct CallFrame CallFrame;
+typedef struct CallFrame     CallFrame;
+typedef struct frame_segment frame_segment;
 typedef struct state     state;
 typedef struct vm_stack  vm_stack;
 typedef struct vm        vm;
@@ -26,12 +38,19 @@ struct CallFrame
 	uint8_t *ip;
 	uint8_t *ip_return;
 	element *slots;
-	uint8_t  return_index;
+};
+
+struct frame_segment
+{
+	frame_segment *prev;
+	frame_segment *next;
+	CallFrame      frames[FRAME_SEGMENT];
 };
 
 struct state
 {
-	uint16_t frame;
+	int      frame;
+	int      frame_max;
 	uint8_t  argc;
 	uint8_t  cargc;
 	uint8_t  native;
@@ -40,23 +59,25 @@ struct state
 
 struct vm_stack
 {
-	stack       *main;
-	stack       *obj;
-	field_stack *init_field;
+	stack *main;
+	stack *obj;
+	stack *literal; /* owns every interned key */
 };
 
 struct vm
 {
 	state count;
 
-	CallFrame frames[FRAMES_MAX];
-	vm_stack  stack;
+	frame_segment *segment;
+	CallFrame     *frame;
+	vm_stack       stack;
 
 	upval    *open_upvals;
-	instance *caller;
+	closure  *script;
 	table    *glob;
 	table    *repl_native;
 	table    *modules;
+	table    *literals;
 };
 
 vm machine;
@@ -64,6 +85,7 @@ vm machine;
 void initVM(void);
 void init_natives(void);
 void freeVM(void);
+void set_frame_limit(int frames);
 
 Interpretation run(void);
 Interpretation interpret(const char *source);
@@ -73,4 +95,8 @@ interpret_path(const char *source, const char *path, const char *name);
 Interpretation
 interpret_export(const char *src, const char *path, const char *name);
 
+closure       *find_function(const char *name);
+Interpretation
+call_function(closure *c, uint8_t argc, element *argv, element *result);
+
 #endif
@@ -2,6 +2,6 @@
 #define _VM_UTIL_H
 #include "object_math.h"
 
-static void close_upvalues(void);
+static void close_upvalues(element *last);
 
 #endif
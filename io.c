@@ -0,0 +1,333 @@
+#include "io.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t page_size(void)
+{
+	static size_t size = 0;
+
+	if (!size)
+		size = (size_t)sysconf(_SC_PAGESIZE);
+	return size;
+}
+
+element map_file(const char *path)
+{
+	struct stat st;
+	int         fd = open(path, O_RDONLY);
+
+	if (fd == -1 || fstat(fd, &st) == -1)
+	{
+		fprintf(stderr, "Could not open file \"%s\".\n", path);
+		exit(74);
+	}
+
+	view *v     = NULL;
+	v           = ALLOC(sizeof(view));
+	v->bytes    = NULL;
+	v->len      = (size_t)st.st_size;
+	v->pos      = 0;
+	v->released = 0;
+	v->term     = NULL;
+	v->held     = 0;
+	v->tail     = NULL;
+
+	/* Private and writable so a slice can be terminated in place; nothing
+	 * is ever written back to the file. */
+	if (v->len > 0)
+	{
+		v->bytes = mmap(
+		    NULL, v->len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0
+		);
+
+		if (v->bytes == MAP_FAILED)
+		{
+			fprintf(stderr, "Could not map file \"%s\".\n", path);
+			exit(74);
+		}
+		posix_madvise(v->bytes, v->len, POSIX_MADV_SEQUENTIAL);
+	}
+	close(fd);
+
+	v->slice           = ALLOC(sizeof(_string));
+	v->slice->String   = NULL;
+	v->slice->len      = 0;
+	v->slice->borrowed = BORROW_ALL;
+	v->slice->release  = NULL;
+	v->slice->ctx      = NULL;
+
+	return GEN(v, T_VIEW);
+}
+
+static void restore(view *v)
+{
+	if (!v->term)
+		return;
+
+	*v->term = v->held;
+	v->term  = NULL;
+}
+
+/* Terminating a slice dirties its page, so drop the private copies of
+ * everything the cursor has passed to keep resident memory flat. */
+static void release(view *v)
+{
+#ifdef MADV_DONTNEED
+	size_t done = v->pos & ~(page_size() - 1);
+
+	if (done - v->released < VIEW_RELEASE * page_size())
+		return;
+
+	madvise(v->bytes + v->released, done - v->released, MADV_DONTNEED);
+	v->released = done;
+#else
+	(void)v;
+#endif
+}
+
+static element slice(view *v, size_t start, size_t end, size_t next)
+{
+	size_t len = end - start;
+
+	if (end < v->len)
+	{
+		v->term          = v->bytes + end;
+		v->held          = *v->term;
+		*v->term         = '\0';
+		v->slice->String = v->bytes + start;
+	}
+	else if (v->len % page_size())
+		v->slice->String = v->bytes + start;
+	else
+	{
+		/* The file ends on a page boundary, so there is no zero fill
+		 * past it to terminate the last slice. */
+		FREE(v->tail);
+		v->tail = ALLOC(len + 1);
+		memcpy(v->tail, v->bytes + start, len);
+		v->tail[len]     = '\0';
+		v->slice->String = v->tail;
+	}
+
+	v->slice->len = (int)len;
+	v->pos        = next;
+
+	return StringEl(v->slice);
+}
+
+element view_line(view *v)
+{
+	restore(v);
+	release(v);
+
+	if (v->pos >= v->len)
+		return Null();
+
+	size_t start = v->pos;
+	char  *nl    = memchr(v->bytes + start, '\n', v->len - start);
+	size_t end   = nl ? (size_t)(nl - v->bytes) : v->len;
+	size_t next  = nl ? end + 1 : end;
+
+	if (end > start && v->bytes[end - 1] == '\r')
+		end--;
+
+	return slice(v, start, end, next);
+}
+
+element view_block(view *v, size_t size)
+{
+	restore(v);
+	release(v);
+
+	if (v->pos >= v->len || size == 0)
+		return Null();
+
+	size_t end = v->pos + size;
+
+	if (end > v->len)
+		end = v->len;
+
+	return slice(v, v->pos, end, end);
+}
+
+void free_view(view **v)
+{
+	if (!*v)
+		return;
+
+	if ((*v)->bytes)
+		munmap((*v)->bytes, (*v)->len);
+
+	FREE((*v)->tail);
+	FREE((*v)->slice);
+	FREE(*v);
+	*v = NULL;
+}
+
+/* Open handles, so teardown can flush and close whatever the script left
+ * open. A closed handle keeps fd -1 and moves to `spare` for the next open
+ * to reuse: a stale reference never dangles, and the lists only grow with
+ * the most handles open at once. */
+static handle *handles = NULL;
+static handle *spare   = NULL;
+
+static int open_flags(const char *mode)
+{
+	int rw = (mode[1] == '+') ? O_RDWR : 0;
+
+	switch (*mode)
+	{
+	case 'r':
+		return rw ? rw : O_RDONLY;
+	case 'w':
+		return (rw ? rw : O_WRONLY) | O_CREAT | O_TRUNC;
+	case 'a':
+		return (rw ? rw : O_WRONLY) | O_CREAT | O_APPEND;
+	default:
+		return -1;
+	}
+}
+
+element open_handle(const char *path, const char *mode)
+{
+	int flags = open_flags(mode);
+	int fd    = (flags == -1) ? -1 : open(path, flags | O_CLOEXEC, 0644);
+
+	if (fd == -1)
+	{
+		fprintf(stderr, "Unable to open file: %s\n", path);
+		exit(1);
+	}
+
+	handle *h = spare;
+
+	if (h)
+		spare = h->next;
+	else
+		h = ALLOC(sizeof(handle));
+
+	h->fd     = fd;
+	h->buf    = NULL;
+	h->count  = 0;
+	h->next   = handles;
+	handles   = h;
+
+	return GEN(h, T_FILE);
+}
+
+static bool write_all(int fd, const char *bytes, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t n = write(fd, bytes, len);
+
+		if (n == -1)
+			return false;
+
+		bytes += n;
+		len -= (size_t)n;
+	}
+	return true;
+}
+
+static bool write_fd(int fd, const char *bytes, size_t len)
+{
+	if (write_all(fd, bytes, len))
+		return true;
+
+	fprintf(stderr, "Unable to write file descriptor: %d\n", fd);
+	return false;
+}
+
+bool flush_handle(handle *h)
+{
+	if (h->fd == -1 || h->count == 0)
+		return true;
+
+	bool ok  = write_fd(h->fd, h->buf, h->count);
+	h->count = 0;
+	return ok;
+}
+
+element write_handle(handle *h, _string *data)
+{
+	size_t len = (size_t)data->len;
+
+	if (h->fd == -1)
+		return Null();
+
+	if (h->count + len > HANDLE_BUFFER && !flush_handle(h))
+		return Null();
+
+	if (len >= HANDLE_BUFFER)
+	{
+		if (!write_fd(h->fd, data->String, len))
+			return Null();
+	}
+	else
+	{
+		if (!h->buf)
+			h->buf = ALLOC(HANDLE_BUFFER);
+
+		memcpy(h->buf + h->count, data->String, len);
+		h->count += len;
+	}
+
+	return Num((double)len);
+}
+
+element read_handle(handle *h, off_t offset, size_t size)
+{
+	if (h->fd == -1 || size == 0)
+		return Null();
+
+	flush_handle(h);
+
+	char   *bytes = ALLOC(size + 1);
+	ssize_t n     = pread(h->fd, bytes, size, offset);
+	element str   = (n > 0) ? String(bytes, (size_t)n) : Null();
+
+	FREE(bytes);
+	return str;
+}
+
+void close_handle(handle *h)
+{
+	if (h->fd == -1)
+		return;
+
+	flush_handle(h);
+	close(h->fd);
+	h->fd = -1;
+
+	FREE(h->buf);
+	h->buf = NULL;
+
+	for (handle **p = &handles; *p; p = &(*p)->next)
+		if (*p == h)
+		{
+			*p = h->next;
+			break;
+		}
+
+	h->next = spare;
+	spare   = h;
+}
+
+void free_handles(void)
+{
+	while (handles)
+		close_handle(handles);
+
+	while (spare)
+	{
+		handle *next = spare->next;
+		FREE(spare);
+		spare = next;
+	}
+}
@@ -1,4 +1,5 @@
 #include "object_string.h"
+#include "profile.h"
 #include "virtual_machine.h"
 #include <fcntl.h>
 #include <limits.h>
@@ -9,30 +10,68 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#define STREAM_BUFFER (1 << 20)
+#define PROFILE_FLAG  "--profile="
+#define COUNT_FLAG    "--count"
+
+static const char *profile   = NULL;
+static bool        count_ops = false;
+
+static void  start(void);
 static void  repl(void);
 static void  run_file(const char *path);
+static void  run_stream(const char *path);
 static char *read_file(char *path);
 
 int main(int argc, char **argv)
 {
+	for (; argc > 1 && strncmp(argv[1], "--", 2) == 0; argv++, argc--)
+	{
+		if (strncmp(argv[1], PROFILE_FLAG, strlen(PROFILE_FLAG)) == 0)
+			profile = argv[1] + strlen(PROFILE_FLAG);
+		else if (strcmp(argv[1], COUNT_FLAG) == 0)
+			count_ops = true;
+		else
+			break;
+	}
+
+	if ((profile && !*profile) || (argc > 1 && strncmp(argv[1], "--", 2) == 0))
+		argc = -1;
 
 	if (argc == 1)
 		repl();
 	else if (argc == 2)
 		run_file(argv[1]);
+	else if (argc == 3 && strcmp(argv[1], "-n") == 0)
+		run_stream(argv[2]);
 	else
 	{
-		fprintf(stderr, "USAGE: ykes [path]\n");
+		fprintf(
+		    stderr, "USAGE: ykes [--profile=out.folded] [--count] [-n] [path]\n"
+		);
 		exit(69);
 	}
 
 	return EXIT_SUCCESS;
 }
 
+/* Samples are taken for the whole run, top level included, and written
+ * as folded stacks when the VM is freed or the process exits. Counts
+ * are reported on stderr at the same point. */
+static void start(void)
+{
+	initVM();
+
+	if (profile)
+		start_profile(profile);
+	if (count_ops)
+		start_count();
+}
+
 static void repl(void)
 {
 
-	initVM();
+	start();
 	buffer b;
 	// arena ar = GROW_ARENA(NULL, 1024 * sizeof(char), ARENA_STR);
 
@@ -119,7 +158,90 @@ static char *get_full_path(char *path)
 
 static void run_file(const char *path)
 {
-	initVM();
+	start();
+
+	char *source = NULL;
+	source       = read_file(get_full_path((char *)path));
+
+	char *name = NULL;
+	name       = get_name((char *)path);
+	strip_path((char *)path);
+
+	Interpretation result = interpret_path(source, path, name);
+	FREE(source);
+
+	if (result == INTERPRET_COMPILE_ERR)
+		exit(65);
+	if (result == INTERPRET_RUNTIME_ERR)
+		exit(70);
+
+	freeVM();
+}
+
+static void call_hook(closure *c, uint8_t argc, element *argv)
+{
+	if (c && call_function(c, argc, argv, NULL) != INTERPRET_SUCCESS)
+		exit(70);
+}
+
+/* Hands `line` one borrowed slice of the buffer per input line. The
+ * slice is terminated in place and only valid for the duration of the
+ * call; the buffer is refilled by sliding the partial tail to the front
+ * and only grows when a single line outgrows it. */
+static void stream_lines(closure *fn)
+{
+	size_t len   = STREAM_BUFFER;
+	size_t held  = 0;
+	char  *buf   = ALLOC(len + 1);
+
+	_string line;
+	line.borrowed = BORROW_ALL;
+	line.release  = NULL;
+	line.ctx      = NULL;
+
+	element arg = GEN(&line, T_STR);
+	ssize_t n   = 0;
+
+	do
+	{
+		if (held == len)
+		{
+			buf = REALLOC(buf, len + 1, len * 2 + 1);
+			len *= 2;
+		}
+
+		n = read(STDIN_FILENO, buf + held, len - held);
+		held += (n > 0) ? (size_t)n : 0;
+
+		char *start = buf;
+		char *end   = buf + held;
+		char *nl    = NULL;
+
+		while ((nl = memchr(start, '\n', end - start)) || (n <= 0 && start < end))
+		{
+			char *stop = nl ? nl : end;
+
+			if (stop > start && stop[-1] == '\r')
+				--stop;
+
+			*stop       = '\0';
+			line.String = start;
+			line.len    = (int)(stop - start);
+			call_hook(fn, 1, &arg);
+
+			start = nl ? nl + 1 : end;
+		}
+
+		held = end - start;
+		memmove(buf, start, held);
+	} while (n > 0);
+
+	FREE(buf);
+}
+
+static void run_stream(const char *path)
+{
+	start();
 
 	char *source = NULL;
 	source       = read_file(get_full_path((char *)path));
@@ -136,6 +258,18 @@ static void run_file(const char *path)
 	if (result == INTERPRET_RUNTIME_ERR)
 		exit(70);
 
+	closure *line = find_function("line");
+
+	if (!line)
+	{
+		fprintf(stderr, "Streaming mode requires a `line` function.\n");
+		exit(65);
+	}
+
+	call_hook(find_function("begin"), 0, NULL);
+	stream_lines(line);
+	call_hook(find_function("end"), 0, NULL);
+
 	freeVM();
 }
 
@@ -4,32 +4,49 @@
 
 #define ARM64_PAGE 16384
 
-static _free *mem = NULL;
-static void   merge_list(void);
+typedef struct region region;
+
+/* Every mapping starts with one of these so teardown can unmap it; the
+ * free list only ever holds pieces of mappings, not their bases. */
+struct region
+{
+	region *next;
+	size_t  size;
+};
+
+static _free  *mem     = NULL;
+static region *regions = NULL;
+static void    merge_list(void);
 
 static void *request_system_memory(size_t size)
 {
-	return mmap(
-	    NULL, size, PROT_READ | PROT_WRITE,
+	region *r = mmap(
+	    NULL, size + sizeof(region), PROT_READ | PROT_WRITE,
 
 	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
 	);
+
+	r->next = regions;
+	r->size = size + sizeof(region);
+	regions = r;
+	return r + 1;
 }
 void initialize_global_mem(void)
 {
-	mem = NULL;
+	mem     = NULL;
+	regions = NULL;
 }
 
 void destroy_global_memory(void)
 {
 
-	_free *tmp = NULL;
+	region *tmp = NULL;
 
-	while (mem)
+	while (regions)
 	{
-		tmp = mem->next;
-		munmap(mem, mem->size);
-		mem = tmp;
+		tmp = regions->next;
+		munmap(regions, regions->size);
+		regions = tmp;
 	}
 	tmp = NULL;
 	mem = NULL;
@@ -1,9 +1,12 @@
+#include "io.h"
 #include "native.h"
+#include "net.h"
 #include "object_memory.h"
 
 #include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 static element get_file(const char *path)
@@ -99,17 +102,46 @@ static void write_file(const char *path, const char *data)
 
 element file_native(int argc, element *argv)
 {
-	(void)argc;
 	switch (*STR((*argv))->String)
 	{
 	case 'r':
 		return get_file(STR(argv[1])->String);
+	case 'o':
+		return open_handle(
+		    STR(argv[1])->String, (argc > 2) ? STR(argv[2])->String : "r"
+		);
 	case 'w':
-		write_file(STR(argv[1])->String, STR(argv[2])->String);
-		return Null();
 	case 'a':
-		append_file(STR(argv[1])->String, STR(argv[2])->String);
+		if (argv[1].type == T_FILE)
+			return write_handle(HANDLE(argv[1]), STR(argv[2]));
+
+		if (*STR((*argv))->String == 'w')
+			write_file(STR(argv[1])->String, STR(argv[2])->String);
+		else
+			append_file(STR(argv[1])->String, STR(argv[2])->String);
 		return Null();
+	case 'p':
+		if (argc < 4 || argv[1].type != T_FILE)
+			return Null();
+		return read_handle(
+		    HANDLE(argv[1]), (off_t)NUM(argv[2]), (size_t)NUM(argv[3])
+		);
+	case 'f':
+		if (argv[1].type == T_FILE)
+			flush_handle(HANDLE(argv[1]));
+		return Null();
+	case 'c':
+		if (argv[1].type == T_FILE)
+			close_handle(HANDLE(argv[1]));
+		return Null();
+	case 'm':
+		return map_file(STR(argv[1])->String);
+	case 'l':
+		return (argv[1].type == T_VIEW) ? view_line(VIEW(argv[1])) : Null();
+	case 'b':
+		if (argc < 3 || argv[1].type != T_VIEW)
+			return Null();
+		return view_block(VIEW(argv[1]), (size_t)NUM(argv[2]));
 	default:
 		return Null();
 	}
@@ -120,6 +152,31 @@ element square_native(int argc, element *argv)
 	(void)argc;
 	return _sqr(argv);
 }
+element abs_native(int argc, element *argv)
+{
+	(void)argc;
+	return _abs(argv);
+}
+element floor_native(int argc, element *argv)
+{
+	(void)argc;
+	return _floor(argv);
+}
+element min_native(int argc, element *argv)
+{
+	(void)argc;
+	return _min(argv, argv + 1);
+}
+element max_native(int argc, element *argv)
+{
+	(void)argc;
+	return _max(argv, argv + 1);
+}
+element pow_native(int argc, element *argv)
+{
+	(void)argc;
+	return _pow(argv, argv + 1);
+}
 element clock_native(int argc, element *el)
 {
 	(void)argc;
@@ -133,15 +190,37 @@ element string_native(int argc, element *el)
 	return Null();
 }
 
-static void define_native(stack **stk, _key *ar, NativeFn n, uint8_t index)
+static void
+define_native(stack **stk, _key *ar, NativeFn n, int arity, uint8_t index)
 {
 	element el            = GEN(_native(n, ar), T_NATIVE);
+	NATIVE(el)->arity     = arity;
 	*((*stk)->as + index) = el;
 }
 
+const yk_native_def builtin_natives[] = {
+    {"clock", clock_native, 0},
+    {"square", square_native, 1},
+    {"file", file_native, YK_VARIADIC},
+    {"net", net_native, YK_VARIADIC},
+    {"sqrt", square_native, 1},
+    {"abs", abs_native, 1},
+    {"floor", floor_native, 1},
+    {"min", min_native, 2},
+    {"max", max_native, 2},
+    {"pow", pow_native, 2},
+    {NULL, NULL, 0},
+};
+
+const int builtin_count =
+    (int)(sizeof(builtin_natives) / sizeof(*builtin_natives)) - 1;
+
 void define_natives(stack **stk)
 {
-	define_native(stk, Key("clock", 5), clock_native, 0);
-	define_native(stk, Key("square", 6), square_native, 1);
-	define_native(stk, Key("file", 4), file_native, 2);
+	for (uint8_t i = 0; builtin_natives[i].name; i++)
+		define_native(
+		    stk,
+		    Key(builtin_natives[i].name, strlen(builtin_natives[i].name)),
+		    builtin_natives[i].fn, builtin_natives[i].arity, i
+		);
 }
@@ -0,0 +1,335 @@
+#include "net.h"
+#include "object_memory.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+typedef struct connection connection;
+
+/* One slot per open descriptor. `buf` is allocated on the first read and
+ * received into by every read after it; each read hands the script a copy.
+ */
+struct connection
+{
+	int   fd;
+	bool  listening;
+	char *buf;
+};
+
+static connection *conns[NET_MAX_CONN];
+
+static int ev_fd = -1;
+static int ready[NET_EVENTS];
+static int ready_count = 0;
+static int ready_next  = 0;
+
+static int int_arg(element el)
+{
+	return IS_NUM(el) ? (int)NUM(el) : -1;
+}
+
+static connection *get_conn(element el)
+{
+	int fd = int_arg(el);
+
+	if (fd < 0 || fd >= NET_MAX_CONN)
+		return NULL;
+	return conns[fd];
+}
+
+static bool watch(int fd)
+{
+#ifdef __linux__
+	if (ev_fd == -1 && (ev_fd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+		return false;
+
+	struct epoll_event ev;
+	ev.events  = EPOLLIN;
+	ev.data.fd = fd;
+
+	return epoll_ctl(ev_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+#else
+	(void)fd;
+	return true;
+#endif
+}
+
+static element add_conn(int fd, bool listening)
+{
+	if (fd >= NET_MAX_CONN || fcntl(fd, F_SETFL, O_NONBLOCK) == -1 ||
+	    !watch(fd))
+	{
+		close(fd);
+		return Null();
+	}
+
+	if (!listening)
+	{
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	}
+
+	connection *conn = NULL;
+	conn             = ALLOC(sizeof(connection));
+	conn->fd         = fd;
+	conn->listening  = listening;
+	conn->buf        = NULL;
+	conns[fd]        = conn;
+
+	return Num(fd);
+}
+
+static int open_socket(const char *host, int port, bool server)
+{
+	struct addrinfo  hints;
+	struct addrinfo *res = NULL;
+	char             service[16];
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags    = server ? AI_PASSIVE : 0;
+
+	snprintf(service, sizeof(service), "%d", port);
+
+	if (getaddrinfo(host, service, &hints, &res) != 0)
+		return -1;
+
+	int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+
+	if (fd == -1)
+	{
+		freeaddrinfo(res);
+		return -1;
+	}
+
+	if (server)
+	{
+		int one = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+		if (bind(fd, res->ai_addr, res->ai_addrlen) == -1 ||
+		    listen(fd, SOMAXCONN) == -1)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	else
+	{
+		fcntl(fd, F_SETFL, O_NONBLOCK);
+
+		if (connect(fd, res->ai_addr, res->ai_addrlen) == -1 &&
+		    errno != EINPROGRESS)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+
+	freeaddrinfo(res);
+	return fd;
+}
+
+static element net_listen(int argc, element *argv)
+{
+	const char *host = NULL;
+	int         port = 0;
+
+	if (argc > 2 && argv[1].type == T_STR)
+	{
+		host = STR(argv[1])->String;
+		port = int_arg(argv[2]);
+	}
+	else if (argc > 1)
+		port = int_arg(argv[1]);
+
+	int fd = open_socket(host, port, true);
+	return (fd == -1) ? Null() : add_conn(fd, true);
+}
+
+static element net_connect(int argc, element *argv)
+{
+	if (argc < 3 || argv[1].type != T_STR)
+		return Null();
+
+	int fd = open_socket(STR(argv[1])->String, int_arg(argv[2]), false);
+	return (fd == -1) ? Null() : add_conn(fd, false);
+}
+
+static element net_accept(connection *conn)
+{
+	if (!conn || !conn->listening)
+		return Null();
+
+	int fd = accept(conn->fd, NULL, NULL);
+	return (fd == -1) ? Null() : add_conn(fd, false);
+}
+
+static element net_port(connection *conn)
+{
+	struct sockaddr_in addr;
+	socklen_t          len = sizeof(addr);
+
+	if (!conn || getsockname(conn->fd, (struct sockaddr *)&addr, &len) == -1)
+		return Null();
+
+	return Num(ntohs(addr.sin_port));
+}
+
+static element net_read(connection *conn)
+{
+	if (!conn || conn->listening)
+		return Null();
+
+	if (!conn->buf)
+		conn->buf = ALLOC(NET_BUFFER);
+
+	ssize_t n = recv(conn->fd, conn->buf, NET_BUFFER, 0);
+
+	if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+		return Null();
+
+	size_t len = (n < 0) ? 0 : (size_t)n;
+	char  *str = ALLOC(len + 1);
+
+	memcpy(str, conn->buf, len);
+	str[len] = '\0';
+
+	return StringCpy(str, len);
+}
+
+static element net_write(connection *conn, element data)
+{
+	if (!conn || conn->listening || data.type != T_STR)
+		return Null();
+
+	ssize_t n = send(
+	    conn->fd, STR(data)->String, STR(data)->len, MSG_NOSIGNAL
+	);
+
+	if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+		return Null();
+
+	return Num(n < 0 ? 0 : n);
+}
+
+static void net_close(connection *conn)
+{
+	if (!conn)
+		return;
+
+	for (int i = ready_next; i < ready_count; i++)
+		if (ready[i] == conn->fd)
+			ready[i] = -1;
+
+	close(conn->fd);
+	conns[conn->fd] = NULL;
+
+	if (conn->buf)
+		FREE(conn->buf);
+	FREE(conn);
+}
+
+static element net_wait(int timeout)
+{
+	for (; ready_next < ready_count; ready_next++)
+		if (ready[ready_next] != -1)
+			return Num(ready[ready_next++]);
+
+	int n = 0;
+
+#ifdef __linux__
+	struct epoll_event events[NET_EVENTS];
+
+	if (ev_fd != -1)
+		n = epoll_wait(ev_fd, events, NET_EVENTS, timeout);
+
+	for (int i = 0; i < n; i++)
+		ready[i] = events[i].data.fd;
+#else
+	struct pollfd fds[NET_MAX_CONN];
+	int           nfds = 0;
+
+	for (int i = 0; i < NET_MAX_CONN; i++)
+		if (conns[i])
+		{
+			fds[nfds].fd       = i;
+			fds[nfds].events   = POLLIN;
+			fds[nfds++].revents = 0;
+		}
+
+	if (poll(fds, nfds, timeout) > 0)
+		for (int i = 0; i < nfds && n < NET_EVENTS; i++)
+			if (fds[i].revents)
+				ready[n++] = fds[i].fd;
+#endif
+
+	ready_count = (n < 0) ? 0 : n;
+	ready_next  = 0;
+
+	return (ready_count > 0) ? Num(ready[ready_next++]) : Null();
+}
+
+element net_native(int argc, element *argv)
+{
+	if (argc < 1 || argv->type != T_STR)
+		return Null();
+
+	const char *op = STR((*argv))->String;
+
+	if (strcmp(op, "listen") == 0)
+		return net_listen(argc, argv);
+	if (strcmp(op, "connect") == 0)
+		return net_connect(argc, argv);
+	if (strcmp(op, "wait") == 0)
+		return net_wait(argc > 1 ? int_arg(argv[1]) : -1);
+
+	if (argc < 2)
+		return Null();
+
+	connection *conn = get_conn(argv[1]);
+
+	if (strcmp(op, "accept") == 0)
+		return net_accept(conn);
+	if (strcmp(op, "read") == 0)
+		return net_read(conn);
+	if (strcmp(op, "write") == 0)
+		return net_write(conn, argc > 2 ? argv[2] : Null());
+	if (strcmp(op, "port") == 0)
+		return net_port(conn);
+	if (strcmp(op, "close") == 0)
+		net_close(conn);
+
+	return Null();
+}
+
+void free_net(void)
+{
+	for (int i = 0; i < NET_MAX_CONN; i++)
+		net_close(conns[i]);
+
+	if (ev_fd != -1)
+		close(ev_fd);
+
+	ev_fd       = -1;
+	ready_count = 0;
+	ready_next  = 0;
+}
@@ -43,6 +43,12 @@ element Num(double Num)
 	ar.Num = Num;
 	return OBJ(ar, T_NUM);
 }
+element Int(Long Int)
+{
+	value ar;
+	ar.Int = Int;
+	return OBJ(ar, T_INT);
+}
 
 element NumType(double Num, obj_t type)
 {
@@ -72,9 +78,12 @@ element StringCpy(const char *str, size_t size)
 
 	ar = ALLOC(sizeof(_string));
 
-	ar->String = NULL;
-	ar->String = (char *)str;
-	ar->len    = size;
+	ar->String   = NULL;
+	ar->String   = (char *)str;
+	ar->len      = size;
+	ar->borrowed = 0;
+	ar->release  = NULL;
+	ar->ctx      = NULL;
 	return GEN(ar, T_STR);
 }
 element StringEl(_string *s)
@@ -92,6 +101,9 @@ element String(const char *str, size_t size)
 	memcpy(ar->String, str, size);
 	ar->String[size] = '\0';
 	ar->len          = size;
+	ar->borrowed     = 0;
+	ar->release      = NULL;
+	ar->ctx          = NULL;
 	return GEN(ar, T_STR);
 }
 
@@ -186,6 +198,9 @@ static void println(element ar)
 	case T_CHAR:
 		printf("'%c'", ar.val.Char);
 		break;
+	case T_INT:
+		ar = Num((double)ar.val.Int);
+		/* fall through */
 	case T_NUM:
 		printf("%f", ar.val.Num);
 		break;
@@ -195,6 +210,12 @@ static void println(element ar)
 	case T_STR:
 		parse_str(STR(ar)->String);
 		break;
+	case T_VIEW:
+		printf("<view: %zu bytes>", VIEW(ar)->len);
+		break;
+	case T_FILE:
+		printf("<file: %d>", HANDLE(ar)->fd);
+		break;
 	case T_NULL:
 		printf("[ null ]");
 		break;
@@ -277,6 +298,9 @@ void print(element ar)
 	case T_CHAR:
 		printf("'%c'\n", ar.val.Char);
 		break;
+	case T_INT:
+		ar = Num((double)ar.val.Int);
+		/* fall through */
 	case T_NUM:
 		printf("%f\n", ar.val.Num);
 		break;
@@ -287,6 +311,12 @@ void print(element ar)
 		parse_str(STR(ar)->String);
 		printf("\n");
 		break;
+	case T_VIEW:
+		printf("<view: %zu bytes>\n", VIEW(ar)->len);
+		break;
+	case T_FILE:
+		printf("<file: %d>\n", HANDLE(ar)->fd);
+		break;
 	case T_NULL:
 		printf("[ null ]\n");
 		break;
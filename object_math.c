@@ -1,8 +1,16 @@
 #include "error.h"
 #include "object_math.h"
 #include "object_string.h"
+#include <limits.h>
 #include <math.h>
 
+/* Integer operands stay integers until an operation overflows, at which
+ * point the result is computed in double precision instead. */
+static bool numeric(element *a, element *b)
+{
+	return IS_NUM((*a)) && IS_NUM((*b));
+}
+
 element _neg(element *a)
 {
 
@@ -10,6 +18,10 @@ element _neg(element *a)
 	{
 	case T_NUM:
 		return Num(-a->val.Num);
+	case T_INT:
+		if (a->val.Int == LLONG_MIN)
+			return Num(-(double)a->val.Int);
+		return Int(-a->val.Int);
 	case T_CHAR:
 		return Char(-a->val.Char);
 	case T_BOOL:
@@ -22,13 +34,19 @@ element _neg(element *a)
 
 element _add(element *a, element *b)
 {
+	Long r;
 
 	switch (b->type)
 	{
+	case T_INT:
+		if (a->type == T_INT &&
+		    !__builtin_add_overflow(b->val.Int, a->val.Int, &r))
+			return Int(r);
+		/* fall through */
 	case T_NUM:
-		return Num(b->val.Num + a->val.Num);
+		return Num(NUM((*b)) + NUM((*a)));
 	case T_CHAR:
-		return Char(b->val.Char + a->val.Num);
+		return Char(b->val.Char + NUM((*a)));
 	case T_STR:
 		return append(b, a);
 	default:
@@ -42,6 +60,8 @@ element _to_str(element *a)
 	{
 	case T_NUM:
 		return lltoa(a->val.Num);
+	case T_INT:
+		return lltoa(a->val.Int);
 	case T_CHAR:
 		return char_to_str(a->val.Char);
 		// case T_VECTOR:
@@ -64,15 +84,15 @@ element _cast(element *a, cast_t type)
 	switch (type)
 	{
 	case CAST_NUM_CHAR:
-		return Char((char)a->val.Num);
+		return Char((char)NUM((*a)));
 	case CAST_NUM_STR:
-		return lltoa((Long)a->val.Num);
+		return lltoa((Long)NUM((*a)));
 	case CAST_CHAR_NUM:
-		return Num((Long)a->val.Char);
+		return Int(a->val.Char);
 	case CAST_CHAR_STR:
 		return char_to_str(a->val.Char);
 	case CAST_BOOL_NUM:
-		return Num(a->val.Bool);
+		return Int(a->val.Bool);
 	case CAST_BOOL_STR:
 		return String(
 		    (a->val.Bool) ? "true" : "false", (a->val.Bool) ? 4 : 5
@@ -95,6 +115,10 @@ element _inc(element *a)
 	{
 	case T_NUM:
 		return Num(++a->val.Num);
+	case T_INT:
+		if (a->val.Int == LLONG_MAX)
+			return Num((double)a->val.Int + 1);
+		return Int(++a->val.Int);
 	case T_CHAR:
 		return Char(++a->val.Char);
 	default:
@@ -109,6 +133,10 @@ element _dec(element *a)
 	{
 	case T_NUM:
 		return Num(--a->val.Num);
+	case T_INT:
+		if (a->val.Int == LLONG_MIN)
+			return Num((double)a->val.Int - 1);
+		return Int(--a->val.Int);
 	case T_CHAR:
 		return Char(--a->val.Char);
 	default:
@@ -118,16 +146,22 @@ element _dec(element *a)
 }
 element _sub(element *a, element *b)
 {
+	Long r;
 
-	if (a->type != b->type)
+	if (a->type != b->type && !numeric(a, b))
 	{
 		error("Invalid comparison");
 		exit(1);
 	}
 	switch (b->type)
 	{
+	case T_INT:
+		if (a->type == T_INT &&
+		    !__builtin_sub_overflow(b->val.Int, a->val.Int, &r))
+			return Int(r);
+		/* fall through */
 	case T_NUM:
-		return Num(b->val.Num - a->val.Num);
+		return Num(NUM((*b)) - NUM((*a)));
 	case T_CHAR:
 		return Char(b->val.Char - a->val.Char);
 	default:
@@ -137,16 +171,22 @@ element _sub(element *a, element *b)
 }
 element _mul(element *a, element *b)
 {
+	Long r;
 
-	if (a->type != b->type)
+	if (a->type != b->type && !numeric(a, b))
 	{
 		error("Invalid comparison");
 		exit(1);
 	}
 	switch (b->type)
 	{
+	case T_INT:
+		if (a->type == T_INT &&
+		    !__builtin_mul_overflow(b->val.Int, a->val.Int, &r))
+			return Int(r);
+		/* fall through */
 	case T_NUM:
-		return Num(b->val.Num * a->val.Num);
+		return Num(NUM((*b)) * NUM((*a)));
 	case T_CHAR:
 		return Num((Long)b->val.Char * a->val.Char);
 	default:
@@ -157,15 +197,16 @@ element _mul(element *a, element *b)
 element _div(element *a, element *b)
 {
 
-	if (a->type != b->type)
+	if (a->type != b->type && !numeric(a, b))
 	{
 		error("Invalid comparison");
 		exit(1);
 	}
 	switch (b->type)
 	{
+	case T_INT:
 	case T_NUM:
-		return Num(b->val.Num / a->val.Num);
+		return Num(NUM((*b)) / NUM((*a)));
 	case T_CHAR:
 		return Num((double)b->val.Char / (double)a->val.Char);
 	default:
@@ -176,15 +217,31 @@ element _div(element *a, element *b)
 element _mod(element *a, element *b)
 {
 
-	if (a->type != b->type)
+	if (a->type != b->type && !numeric(a, b))
 	{
 		error("Invalid comparison");
 		exit(1);
 	}
 	switch (b->type)
 	{
+	case T_INT:
+		if (a->type == T_INT)
+		{
+			if (a->val.Int == 0)
+			{
+				error("Invalid `%` operation. Modulo by zero");
+				exit(1);
+			}
+			return Int((a->val.Int == -1) ? 0 : b->val.Int % a->val.Int);
+		}
+		/* fall through */
 	case T_NUM:
-		return Num((Long)b->val.Num % (Long)a->val.Num);
+		if (NUM((*a)) == 0)
+		{
+			error("Invalid `%` operation. Modulo by zero");
+			exit(1);
+		}
+		return Num(fmod(NUM((*b)), NUM((*a))));
 	case T_CHAR:
 		return Char(b->val.Char % a->val.Char);
 	default:
@@ -195,19 +252,23 @@ element _mod(element *a, element *b)
 element _eq(element *a, element *b)
 {
 
-	if (a->type != b->type)
+	if (a->type != b->type && !numeric(a, b))
 	{
 		error("Invalid comparison");
 		exit(1);
 	}
 	switch (b->type)
 	{
+	case T_INT:
+		if (a->type == T_INT)
+			return Bool(b->val.Int == a->val.Int);
+		/* fall through */
 	case T_NUM:
-		return Bool(b->val.Num == a->val.Num);
+		return Bool(NUM((*b)) == NUM((*a)));
 	case T_CHAR:
 		return Bool(b->val.Char == a->val.Char);
 	case T_STR:
-		return string_ne(b, a);
+		return string_eq(b, a);
 	default:
 		error("Invalid type for `==` operation");
 		exit(1);
@@ -216,15 +277,19 @@ element _eq(element *a, element *b)
 element _ne(element *a, element *b)
 {
 
-	if (a->type != b->type)
+	if (a->type != b->type && !numeric(a, b))
 	{
 		error("Invalid comparison");
 		exit(1);
 	}
 	switch (b->type)
 	{
+	case T_INT:
+		if (a->type == T_INT)
+			return Bool(b->val.Int != a->val.Int);
+		/* fall through */
 	case T_NUM:
-		return Bool(b->val.Num != a->val.Num);
+		return Bool(NUM((*b)) != NUM((*a)));
 	case T_CHAR:
 		return Bool(b->val.Char != a->val.Char);
 	case T_STR:
@@ -237,15 +302,19 @@ element _ne(element *a, element *b)
 element _lt(element *a, element *b)
 {
 
-	if (a->type != b->type)
+	if (a->type != b->type && !numeric(a, b))
 	{
 		error("Invalid comparison");
 		exit(1);
 	}
 	switch (b->type)
 	{
+	case T_INT:
+		if (a->type == T_INT)
+			return Bool(b->val.Int < a->val.Int);
+		/* fall through */
 	case T_NUM:
-		return Bool(b->val.Num < a->val.Num);
+		return Bool(NUM((*b)) < NUM((*a)));
 	case T_CHAR:
 		return Bool(b->val.Char < a->val.Char);
 	case T_STR:
@@ -258,15 +327,19 @@ element _lt(element *a, element *b)
 element _le(element *a, element *b)
 {
 
-	if (a->type != b->type)
+	if (a->type != b->type && !numeric(a, b))
 	{
 		error("Invalid comparison");
 		exit(1);
 	}
 	switch (b->type)
 	{
+	case T_INT:
+		if (a->type == T_INT)
+			return Bool(b->val.Int <= a->val.Int);
+		/* fall through */
 	case T_NUM:
-		return Bool(b->val.Num <= a->val.Num);
+		return Bool(NUM((*b)) <= NUM((*a)));
 	case T_CHAR:
 		return Bool(b->val.Char <= a->val.Char);
 	case T_STR:
@@ -279,15 +352,19 @@ element _le(element *a, element *b)
 element _gt(element *a, element *b)
 {
 
-	if (a->type != b->type)
+	if (a->type != b->type && !numeric(a, b))
 	{
 		error("Invalid comparison");
 		exit(1);
 	}
 	switch (b->type)
 	{
+	case T_INT:
+		if (a->type == T_INT)
+			return Bool(b->val.Int > a->val.Int);
+		/* fall through */
 	case T_NUM:
-		return Bool(b->val.Num > a->val.Num);
+		return Bool(NUM((*b)) > NUM((*a)));
 	case T_CHAR:
 		return Bool(b->val.Char > a->val.Char);
 	case T_STR:
@@ -300,15 +377,19 @@ element _gt(element *a, element *b)
 element _ge(element *a, element *b)
 {
 
-	if (a->type != b->type)
+	if (a->type != b->type && !numeric(a, b))
 	{
 		error("Invalid comparison");
 		exit(1);
 	}
 	switch (b->type)
 	{
+	case T_INT:
+		if (a->type == T_INT)
+			return Bool(b->val.Int >= a->val.Int);
+		/* fall through */
 	case T_NUM:
-		return Bool(b->val.Num >= a->val.Num);
+		return Bool(NUM((*b)) >= NUM((*a)));
 	case T_CHAR:
 		return Bool(b->val.Char >= a->val.Char);
 	case T_STR:
@@ -328,15 +409,108 @@ element _and(element *a, element *b)
 	return Bool(b->val.Bool && a->val.Bool);
 }
 
+static Long integer(element *a)
+{
+	return (a->type == T_INT) ? a->val.Int : (Long)a->val.Num;
+}
+
+element _bit_and(element *a, element *b)
+{
+	if (!numeric(a, b))
+	{
+		error("Invalid type for `&` operation");
+		exit(1);
+	}
+
+	return Int(integer(b) & integer(a));
+}
+element _bit_or(element *a, element *b)
+{
+	if (!numeric(a, b))
+	{
+		error("Invalid type for `|` operation");
+		exit(1);
+	}
+
+	return Int(integer(b) | integer(a));
+}
+
 element _sqr(element *a)
 {
-	if (a->type != T_NUM)
+	if (!IS_NUM((*a)))
 	{
 		error("Invalid square root operation. Expected type number");
 		exit(1);
 	}
 
-	return Num(sqrt(a->val.Num));
+	return Num(sqrt(NUM((*a))));
+}
+
+element _abs(element *a)
+{
+	if (!IS_NUM((*a)))
+	{
+		error("Invalid `abs` operation. Expected type number");
+		exit(1);
+	}
+
+	if (a->type == T_INT && a->val.Int != LLONG_MIN)
+		return Int(llabs(a->val.Int));
+
+	return Num(fabs(NUM((*a))));
+}
+
+element _floor(element *a)
+{
+	if (!IS_NUM((*a)))
+	{
+		error("Invalid `floor` operation. Expected type number");
+		exit(1);
+	}
+
+	if (a->type == T_INT)
+		return *a;
+
+	return Num(floor(a->val.Num));
+}
+
+element _min(element *a, element *b)
+{
+	if (!numeric(a, b))
+	{
+		error("Invalid `min` operation. Expected type number");
+		exit(1);
+	}
+
+	if (a->type == T_INT && b->type == T_INT)
+		return (a->val.Int < b->val.Int) ? *a : *b;
+
+	return Num(fmin(NUM((*a)), NUM((*b))));
+}
+
+element _max(element *a, element *b)
+{
+	if (!numeric(a, b))
+	{
+		error("Invalid `max` operation. Expected type number");
+		exit(1);
+	}
+
+	if (a->type == T_INT && b->type == T_INT)
+		return (a->val.Int > b->val.Int) ? *a : *b;
+
+	return Num(fmax(NUM((*a)), NUM((*b))));
+}
+
+element _pow(element *a, element *b)
+{
+	if (!numeric(a, b))
+	{
+		error("Invalid `pow` operation. Expected type number");
+		exit(1);
+	}
+
+	return Num(pow(NUM((*a)), NUM((*b))));
 }
 
 element _len(element *a)
@@ -345,13 +519,15 @@ element _len(element *a)
 	switch (a->type)
 	{
 	case T_STR:
-		return Num(STR((*a))->len);
+		return Int(STR((*a))->len);
 	case T_VECTOR:
-		return Num(VECTOR((*a))->count);
+		return Int(VECTOR((*a))->count);
 	case T_VECTOR_2D:
-		return Num(_2D_VECTOR((*a))->count);
+		return Int(_2D_VECTOR((*a))->count);
 	case T_VECTOR_3D:
-		return Num(_3D_VECTOR((*a))->count);
+		return Int(_3D_VECTOR((*a))->count);
+	case T_VIEW:
+		return Int(VIEW((*a))->len);
 	default:
 		error("Unable to get length of invalid object");
 		exit(1);
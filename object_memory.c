@@ -1,12 +1,13 @@
 #include "chunk.h"
+#include "ffi.h"
+#include "io.h"
 #include "object_memory.h"
 
 static void free_entry_list(record entry);
 static void free_instance(instance **ic);
 static void free_stack(stack **stack);
-static void free_upvals(upval ***up, uint8_t uargc);
+static void free_upvals(upval ***up);
 static void free_closure(closure **closure);
-static void free_upval(upval **up);
 static void free_native(native **nat);
 static void free_chunk(chunk *c);
 static void free_function(function **func);
@@ -25,12 +26,15 @@ class *_class(_key *name)
 
 vector *_vector(size_t size, obj_t type)
 {
-	vector *v = NULL;
-	v         = ALLOC(sizeof(vector));
-	v->count  = 0;
-	v->len    = size;
-	v->type   = type;
-	v->of     = NULL;
+	vector *v   = NULL;
+	v           = ALLOC(sizeof(vector));
+	v->count    = 0;
+	v->len      = size;
+	v->type     = type;
+	v->borrowed = 0;
+	v->of       = NULL;
+	v->release  = NULL;
+	v->ctx      = NULL;
 	if (size == 0)
 		size++;
 	v->of = ALLOC(size * sizeof(value));
@@ -107,13 +111,13 @@ stack *realloc_stack(stack **st, size_t size)
 	if (!st)
 		return _stack(size);
 
-	if (size == (*st)->len)
+	if (size == (size_t)(*st)->len)
 		return *st;
 
 	element *as = NULL;
 	as          = ALLOC(sizeof(element) * size);
 
-	for (size_t i = 0; i < (*st)->count; i++)
+	for (size_t i = 0; i < (size_t)(*st)->count; i++)
 		*(as + i) = *((*st)->as + i);
 
 	FREE((*st)->as);
@@ -138,6 +142,7 @@ native *_native(NativeFn func, _key *ar)
 	native *nat = NULL;
 	nat         = ALLOC(sizeof(native));
 	nat->fn     = func;
+	nat->arity  = YK_VARIADIC;
 	nat->name   = NULL;
 	nat->name   = ar;
 	return nat;
@@ -148,6 +153,7 @@ closure *_closure(function *func)
 	clos          = ALLOC(sizeof(closure));
 	clos->func    = func;
 	clos->upvals  = NULL;
+	clos->pooled  = 0;
 	if (!func)
 	{
 		clos->uargc = 0;
@@ -159,13 +165,68 @@ closure *_closure(function *func)
 
 	return clos;
 }
-upval *_upval(element closed, uint8_t index)
+/* Closures made at runtime and the upvalues they capture are carved out of
+ * blocks that are only released with the VM, so a closure built in a loop
+ * costs a pointer bump instead of a malloc. */
+typedef struct pool_block pool_block;
+
+struct pool_block
+{
+	pool_block *next;
+	size_t      used;
+	size_t      len;
+};
+
+static pool_block *pool = NULL;
+
+static void *pool_alloc(size_t size)
+{
+	size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+	if (!pool || pool->used + size > pool->len)
+	{
+		size_t      len   = (size > POOL_BLOCK) ? size : POOL_BLOCK;
+		pool_block *block = NULL;
+		block             = ALLOC(sizeof(pool_block) + len);
+		block->next       = pool;
+		block->used       = 0;
+		block->len        = len;
+		pool              = block;
+	}
+
+	void *ptr = (char *)(pool + 1) + pool->used;
+	pool->used += size;
+	return ptr;
+}
+
+void free_pool(void)
+{
+	while (pool)
+	{
+		pool_block *next = pool->next;
+		FREE(pool);
+		pool = next;
+	}
+}
+
+closure *pool_closure(function *func)
+{
+	closure *clos = NULL;
+	clos          = pool_alloc(sizeof(closure) + sizeof(upval *) * func->uargc);
+	clos->func    = func;
+	clos->upvals  = (upval **)(clos + 1);
+	clos->uargc   = func->uargc;
+	clos->pooled  = 1;
+	return clos;
+}
+
+upval *_upval(element *location)
 {
-	upval *up  = NULL;
-	up         = ALLOC(sizeof(upval));
-	up->index  = index;
-	up->next   = NULL;
-	up->closed = closed;
+	upval *up    = NULL;
+	up           = pool_alloc(sizeof(upval));
+	up->location = location ? location : &up->closed;
+	up->closed   = Null();
+	up->next     = NULL;
 	return up;
 }
 
@@ -204,12 +265,24 @@ void free_2d_vector(_2d_vector **v)
 	FREE(*v);
 	v = NULL;
 }
+void free_values(vector *v)
+{
+	if (!v->borrowed)
+		FREE(v->of);
+	else if (v->release)
+		v->release(v->of, v->ctx);
+
+	v->borrowed = 0;
+	v->release  = NULL;
+	v->ctx      = NULL;
+}
+
 void free_vector(vector **v)
 {
 	if (!*v)
 		return;
 
-	FREE((*v)->of);
+	free_values(*v);
 	(*v)->of = NULL;
 	FREE(*v);
 	v = NULL;
@@ -288,7 +361,7 @@ static void free_stack(stack **stack)
 		return;
 	}
 
-	for (size_t i = 0; i < (*stack)->len; i++)
+	for (size_t i = 0; i < (size_t)(*stack)->len; i++)
 		FREE_OBJ(((*stack)->as + i));
 
 	FREE((*stack)->as);
@@ -296,39 +369,19 @@ static void free_stack(stack **stack)
 	FREE(*stack);
 	stack = NULL;
 }
-static void free_upval(upval **up)
-{
-	if (!*up)
-		return;
-	upval *tmp = NULL;
-
-	while (*up)
-	{
-		tmp = (*up)->next;
-		FREE(tmp);
-		*up = tmp;
-	}
-	up  = NULL;
-	tmp = NULL;
-}
-
-static void free_upvals(upval ***up, uint8_t uargc)
+/* The upvalues themselves belong to the pool. */
+static void free_upvals(upval ***up)
 {
-	if (!*up)
-		return;
-	for (size_t i = 0; i < uargc; i++)
-		free_upval(*(up + i));
-
 	FREE(*up);
-	up = NULL;
+	*up = NULL;
 }
 
 static void free_closure(closure **closure)
 {
-	if (!closure)
+	if (!closure || (*closure)->pooled)
 		return;
 
-	free_upvals(&(*closure)->upvals, (*closure)->uargc);
+	free_upvals(&(*closure)->upvals);
 	free_function(&(*closure)->func);
 	FREE(*closure);
 	closure = NULL;
@@ -344,12 +397,20 @@ static void free_chunk(chunk *c)
 {
 
 	FREE(c->ip);
-	FREE(c->lines);
+	FREE(c->lines.bytes);
 	FREE(c->cases.bytes);
+
+	/* Key constants are interned, the VM's literal pool frees them. */
+	for (int i = 0; i < c->constants->count; i++)
+		if (c->constants->as[i].type == T_KEY)
+			c->constants->as[i] = Null();
+
 	free_stack(&c->constants);
 	c->ip          = NULL;
-	c->lines       = NULL;
+	c->lines.bytes = NULL;
 	c->cases.bytes = NULL;
+	c->hits        = NULL;
+	c->cycles      = NULL;
 	c->constants   = NULL;
 	c              = NULL;
 }
@@ -376,7 +437,17 @@ void free_str(_string **s)
 	if (!*s)
 		return;
 
-	if ((*s)->String)
+	/* A reusable slice is freed by its owner. Otherwise the header is
+	 * ours, and borrowed bytes are handed back if a callback was given. */
+	if ((*s)->borrowed == BORROW_ALL)
+		return;
+
+	if ((*s)->borrowed)
+	{
+		if ((*s)->release)
+			(*s)->release((*s)->String, (*s)->ctx);
+	}
+	else if ((*s)->String)
 		FREE((*s)->String);
 
 	(*s)->String = NULL;
@@ -428,9 +499,6 @@ void free_obj(element *el)
 	case T_INSTANCE:
 		free_instance((instance **)&el->obj);
 		break;
-	case T_UPVAL:
-		free_upval((upval **)&el->obj);
-		break;
 	case T_METHOD:
 	case T_CLOSURE:
 		free_closure((closure **)&el->obj);
@@ -445,6 +513,9 @@ void free_obj(element *el)
 	case T_TABLE:
 		free_table((table **)&el->obj);
 		break;
+	case T_VIEW:
+		free_view((view **)&el->obj);
+		break;
 	default:
 		return;
 	}
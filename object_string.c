@@ -67,7 +67,7 @@ element str_to_num(element *a)
 {
 	Long ll = atoll(STR((*a))->String);
 	free_obj(a);
-	return Num(ll);
+	return Int(ll);
 }
 element str_to_bool(element *a)
 {
@@ -95,6 +95,22 @@ element str_to_char(element *a)
 }
 static element realloc_string(element *ar, size_t size)
 {
+	/* A borrowed string is a view into a buffer owned elsewhere, so the
+	 * lhs of an append gets its own copy instead of growing in place. */
+	if (STR((*ar))->borrowed)
+	{
+		_string *s = NULL;
+		s          = ALLOC(sizeof(_string));
+		s->String  = ALLOC(size + 1);
+		memcpy(s->String, STR((*ar))->String, STR((*ar))->len);
+		s->String[STR((*ar))->len] = '\0';
+		s->len                     = size;
+		s->borrowed                = 0;
+		s->release                 = NULL;
+		s->ctx                     = NULL;
+		return GEN(s, T_STR);
+	}
+
 	STR((*ar))->String = REALLOC(STR((*ar))->String, STR((*ar))->len, size);
 	STR((*ar))->len    = size;
 	return GEN(ar, T_STR);
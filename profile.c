@@ -0,0 +1,473 @@
+#include "profile.h"
+#include "chunk.h"
+#include "debug.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+typedef struct sample  sample;
+typedef struct counted counted;
+
+/* One distinct folded stack and the number of times it was seen. */
+struct sample
+{
+	char *stack;
+	int   hash;
+	int   count;
+};
+
+/* A function that ran under --count. Its counters and listing live here
+ * rather than with the function, which a finished import frees before the
+ * report is printed; the chunk only points at them. */
+struct counted
+{
+	char     *name;
+	int       count;
+	uint64_t *hits;
+	uint64_t *cycles;
+	char     *text;
+	long     *at;
+	uint64_t  total_hits;
+	uint64_t  total_cycles;
+};
+
+volatile sig_atomic_t profile_pending = 0;
+bool                  counting        = false;
+
+static const char *out     = NULL;
+static sample     *samples = NULL;
+static int         count   = 0;
+static int         len     = 0;
+
+static void on_prof(int sig)
+{
+	(void)sig;
+	profile_pending = 1;
+}
+
+static void set_timer(int usec)
+{
+	struct itimerval t;
+
+	t.it_interval.tv_sec  = 0;
+	t.it_interval.tv_usec = usec;
+	t.it_value            = t.it_interval;
+	setitimer(ITIMER_PROF, &t, NULL);
+}
+
+void start_profile(const char *path)
+{
+	struct sigaction sa;
+
+	out = path;
+	atexit(stop_profile);
+
+	sigemptyset(&sa.sa_mask);
+	sa.sa_handler = on_prof;
+	sa.sa_flags   = SA_RESTART;
+	sigaction(SIGPROF, &sa, NULL);
+
+	set_timer(PROFILE_INTERVAL);
+}
+
+static sample *find_sample(sample *s, int n, const char *stack, int hash)
+{
+	int i = hash & (n - 1);
+
+	for (; s[i].stack; i = (i + 1) & (n - 1))
+		if (s[i].hash == hash && strcmp(s[i].stack, stack) == 0)
+			break;
+	return s + i;
+}
+
+static void grow_samples(void)
+{
+	int     n    = len ? len * INC : INIT_SIZE;
+	sample *grow = ALLOC(sizeof(sample) * n);
+
+	memset(grow, 0, sizeof(sample) * n);
+
+	for (int i = 0; i < len; i++)
+		if (samples[i].stack)
+			*find_sample(grow, n, samples[i].stack, samples[i].hash) =
+			    samples[i];
+
+	FREE(samples);
+	samples = grow;
+	len     = n;
+}
+
+static void add_sample(char *stack, int size)
+{
+	int hash = hash_key(stack);
+
+	if (len < (count + 1) * 2)
+		grow_samples();
+
+	sample *s = find_sample(samples, len, stack, hash);
+
+	if (!s->stack)
+	{
+		s->stack = ALLOC(size + 1);
+		memcpy(s->stack, stack, size + 1);
+		s->hash = hash;
+		count++;
+	}
+	s->count++;
+}
+
+/* Walks the frames from the innermost out. `ip` is the next instruction
+ * of the running frame; every frame below it is inside the call that
+ * left `ip_return` in its callee. Frames are printed root first. */
+void profile_sample(uint8_t *ip)
+{
+	const char *name[PROFILE_DEPTH];
+	int         line[PROFILE_DEPTH];
+	int         depth = 0;
+
+	frame_segment *seg   = machine.segment;
+	CallFrame     *frame = machine.frame;
+
+	profile_pending = 0;
+
+	for (int i = machine.count.frame; i > 0 && depth < PROFILE_DEPTH; i--)
+	{
+		chunk *ch = &frame->closure->func->ch;
+
+		name[depth]   = frame->closure->func->name->val;
+		line[depth++] = ip ? chunk_line(ch, (int)(ip - ch->ip), NULL) : 0;
+
+		ip = frame->ip_return ? frame->ip_return - 1 : NULL;
+
+		if (frame > seg->frames)
+			frame--;
+		else if (seg->prev)
+		{
+			seg   = seg->prev;
+			frame = seg->frames + FRAME_SEGMENT - 1;
+		}
+	}
+
+	char stack[PROFILE_STACK];
+	int  size = 0;
+
+	if (machine.count.frame > depth)
+		size = snprintf(stack, PROFILE_STACK, "...;");
+
+	for (int i = depth - 1; i >= 0 && size < PROFILE_STACK; i--)
+		size += snprintf(
+		    stack + size, PROFILE_STACK - size, "%s:%d%s",
+		    name[i] ? name[i] : "?", line[i], i ? ";" : ""
+		);
+
+	add_sample(stack, (size < PROFILE_STACK) ? size : PROFILE_STACK - 1);
+}
+
+void stop_profile(void)
+{
+	if (!out)
+		return;
+
+	set_timer(0);
+	signal(SIGPROF, SIG_DFL);
+	profile_pending = 0;
+
+	FILE *file = fopen(out, "w");
+
+	if (!file)
+		fprintf(stderr, "Could not open file \"%s\".\n", out);
+
+	for (int i = 0; i < len; i++)
+		if (samples[i].stack)
+		{
+			if (file)
+				fprintf(file, "%s %d\n", samples[i].stack, samples[i].count);
+			FREE(samples[i].stack);
+		}
+
+	if (file)
+		fclose(file);
+
+	FREE(samples);
+	samples = NULL;
+	count   = 0;
+	len     = 0;
+	out     = NULL;
+}
+
+static uint64_t  op_hits[OP_COUNT];
+static uint64_t *pair_hits = NULL;
+static counted  *funcs     = NULL;
+static int       nfuncs    = 0;
+static int       funcs_len = 0;
+
+/* The instruction dispatched last, which is charged for the cycles up to
+ * the next one. */
+static uint64_t *last        = NULL;
+static int       last_offset = 0;
+static uint8_t   last_op     = 0;
+static uint64_t  last_cycle  = 0;
+
+/* The time stamp counter where there is one, nanoseconds otherwise. */
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void start_count(void)
+{
+	size_t size = sizeof(uint64_t) * OP_COUNT * OP_COUNT;
+
+	pair_hits = ALLOC(size);
+	memset(pair_hits, 0, size);
+	memset(op_hits, 0, sizeof(op_hits));
+
+	counting = true;
+	atexit(stop_count);
+}
+
+/* Disassembles the function into c->text before it first runs, as a
+ * script may free or grow its string constants in place by the time the
+ * report is printed. c->at holds where each instruction's text starts,
+ * -1 between instructions, and where the text ends at ch->count. */
+static void render(counted *c, chunk *ch)
+{
+	FILE *tmp = tmpfile();
+
+	c->text = NULL;
+	c->at   = ALLOC(sizeof(long) * (ch->count + 1));
+
+	for (int i = 0; i <= ch->count; i++)
+		c->at[i] = -1;
+
+	if (!tmp)
+		return;
+
+	fflush(stdout);
+	int fd = dup(STDOUT_FILENO);
+	dup2(fileno(tmp), STDOUT_FILENO);
+
+	for (int i = 0; i < ch->count;)
+	{
+		fflush(stdout);
+		c->at[i] = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+		i        = disassemble_instruction(ch, i);
+	}
+	fflush(stdout);
+	c->at[ch->count] = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+
+	dup2(fd, STDOUT_FILENO);
+	close(fd);
+
+	c->text = ALLOC(c->at[ch->count] + 1);
+	rewind(tmp);
+	c->text[fread(c->text, 1, c->at[ch->count], tmp)] = '\0';
+	fclose(tmp);
+}
+
+static void track(function *f)
+{
+	size_t size = sizeof(uint64_t) * f->ch.count;
+	char  *name = f->name->val ? f->name->val : "?";
+
+	if (nfuncs == funcs_len)
+	{
+		int n = funcs_len ? funcs_len * INC : INIT_SIZE;
+		funcs = REALLOC(funcs, sizeof(counted) * funcs_len,
+		                sizeof(counted) * n);
+		funcs_len = n;
+	}
+
+	counted *c = funcs + nfuncs++;
+
+	c->name   = ALLOC(strlen(name) + 1);
+	c->count  = f->ch.count;
+	c->hits   = ALLOC(size);
+	c->cycles = ALLOC(size);
+	strcpy(c->name, name);
+	memset(c->hits, 0, size);
+	memset(c->cycles, 0, size);
+	render(c, &f->ch);
+
+	f->ch.hits   = c->hits;
+	f->ch.cycles = c->cycles;
+}
+
+void count_instruction(function *f, uint8_t *ip)
+{
+	uint64_t now    = cycles();
+	int      offset = (int)(ip - f->ch.ip);
+
+	if (last)
+	{
+		last[last_offset] += now - last_cycle;
+		pair_hits[last_op * OP_COUNT + *ip]++;
+	}
+
+	if (!f->ch.hits)
+		track(f);
+
+	f->ch.hits[offset]++;
+	op_hits[*ip]++;
+
+	last        = f->ch.cycles;
+	last_offset = offset;
+	last_op     = *ip;
+	last_cycle  = cycles();
+}
+
+static int by_cycles(const void *a, const void *b)
+{
+	uint64_t x = ((const counted *)a)->total_cycles;
+	uint64_t y = ((const counted *)b)->total_cycles;
+
+	return (x < y) - (x > y);
+}
+
+static int by_hits(const void *a, const void *b)
+{
+	uint64_t x = **(uint64_t *const *)a;
+	uint64_t y = **(uint64_t *const *)b;
+
+	return (x < y) - (x > y);
+}
+
+static double percent(uint64_t n, uint64_t total)
+{
+	return total ? 100.0 * (double)n / (double)total : 0.0;
+}
+
+static void report_function(counted *c, uint64_t total)
+{
+	printf(
+	    "==== `%s`: %llu instructions, %.1f%% of cycles ====\n", c->name,
+	    (unsigned long long)c->total_hits, percent(c->total_cycles, total)
+	);
+
+	for (int i = 0, next; c->text && i < c->count; i = next)
+	{
+		for (next = i + 1; c->at[next] == -1; next++)
+			;
+
+		if (c->hits[i])
+			printf(
+			    "%12llu %14llu %5.1f%% | ", (unsigned long long)c->hits[i],
+			    (unsigned long long)c->cycles[i], percent(c->cycles[i], total)
+			);
+		else
+			printf("%12s %14s %6s | ", "", "", "");
+
+		fwrite(c->text + c->at[i], 1, c->at[next] - c->at[i], stdout);
+	}
+	printf("\n");
+}
+
+static void report_opcodes(uint64_t total)
+{
+	uint64_t *order[OP_COUNT * OP_COUNT];
+	int       n = 0;
+
+	for (int i = 0; i < OP_COUNT; i++)
+		if (op_hits[i])
+			order[n++] = op_hits + i;
+	qsort(order, n, sizeof(uint64_t *), by_hits);
+
+	printf("==== opcodes ====\n");
+	for (int i = 0; i < n; i++)
+		printf(
+		    "%12llu %5.1f%%  %s\n", (unsigned long long)*order[i],
+		    percent(*order[i], total), opcode_name(order[i] - op_hits)
+		);
+
+	n = 0;
+	for (int i = 0; i < OP_COUNT * OP_COUNT; i++)
+		if (pair_hits[i])
+			order[n++] = pair_hits + i;
+	qsort(order, n, sizeof(uint64_t *), by_hits);
+
+	printf("\n==== opcode pairs ====\n");
+	for (int i = 0; i < n && i < COUNT_PAIRS; i++)
+	{
+		int pair = (int)(order[i] - pair_hits);
+
+		printf(
+		    "%12llu %5.1f%%  %s -> %s\n", (unsigned long long)*order[i],
+		    percent(*order[i], total), opcode_name(pair / OP_COUNT),
+		    opcode_name(pair % OP_COUNT)
+		);
+	}
+}
+
+/* Prints each function that ran, hottest first, as its listing annotated
+ * with executions, cycles and share of all cycles, then the opcode and
+ * opcode pair histograms, on stderr to keep them out of the script's own
+ * output. */
+void stop_count(void)
+{
+	if (!counting)
+		return;
+
+	counting = false;
+
+	uint64_t total = 0;
+	uint64_t hits  = 0;
+
+	for (int i = 0; i < nfuncs; i++)
+	{
+		counted *c = funcs + i;
+
+		c->total_hits   = 0;
+		c->total_cycles = 0;
+
+		for (int j = 0; j < c->count; j++)
+		{
+			c->total_hits += c->hits[j];
+			c->total_cycles += c->cycles[j];
+		}
+		hits += c->total_hits;
+		total += c->total_cycles;
+	}
+	qsort(funcs, nfuncs, sizeof(counted), by_cycles);
+
+	fflush(stdout);
+	int fd = dup(STDOUT_FILENO);
+	dup2(STDERR_FILENO, STDOUT_FILENO);
+
+	for (int i = 0; i < nfuncs; i++)
+		report_function(funcs + i, total);
+	report_opcodes(hits);
+
+	fflush(stdout);
+	dup2(fd, STDOUT_FILENO);
+	close(fd);
+
+	for (int i = 0; i < nfuncs; i++)
+	{
+		FREE(funcs[i].name);
+		FREE(funcs[i].hits);
+		FREE(funcs[i].cycles);
+		FREE(funcs[i].text);
+		FREE(funcs[i].at);
+	}
+	FREE(pair_hits);
+	FREE(funcs);
+	pair_hits = NULL;
+	funcs     = NULL;
+	nfuncs    = 0;
+	funcs_len = 0;
+	last      = NULL;
+}
@@ -119,6 +119,7 @@ static token make_token(int t)
 	toke.line  = scan.line;
 	toke.type  = t;
 	toke.size  = (int)(scan.current - scan.start);
+	toke.col   = scan.col - toke.size;
 	return toke;
 }
 static token err_token(const char *err)
@@ -126,6 +127,7 @@ static token err_token(const char *err)
 	token toke;
 	toke.start = err;
 	toke.line  = scan.line;
+	toke.col   = scan.col;
 	toke.type  = TOKEN_ERR;
 	toke.size  = strlen(err);
 	return toke;
@@ -176,7 +178,7 @@ static token id(void)
 }
 static token character(void)
 {
-	nskip(2);
+	nskip(next() == '\\' ? 3 : 2);
 	return make_token(TOKEN_CHAR);
 }
 
@@ -403,6 +405,7 @@ static bool match(char expected)
 	if (next() != expected || end())
 		return false;
 	scan.current++;
+	scan.col++;
 	return true;
 }
 static bool end(void)
@@ -425,7 +428,7 @@ static void skip_line_comment(void)
 
 	if (!end())
 		scan.line++;
-	scan.col = 1;
+	scan.col = 0;
 
 	skip();
 }
@@ -440,7 +443,7 @@ static void skip_multi_line_comment(void)
 		else if (*scan.current == '\n')
 		{
 			scan.line++;
-			scan.col = 1;
+			scan.col = 0;
 		}
 		else if (*scan.current == '*' && scan.current[1] == '/')
 			break;
@@ -470,7 +473,7 @@ static void skip_whitespace(void)
 		{
 		case '\n':
 			scan.line++;
-			scan.col = 1;
+			scan.col = 0;
 			break;
 
 		case '/':
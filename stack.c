@@ -1,5 +1,7 @@
 #include "stack.h"
 #include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 static void check_stack_size(stack **s)
 {
@@ -9,15 +11,6 @@ static void check_stack_size(stack **s)
 	if ((*s)->count + 1 > (*s)->len)
 		*s = GROW_STACK(s, (*s)->len * INC);
 }
-static void check_fstack_size(field_stack **s)
-{
-
-	if (!*s || !(*s)->fields)
-		return;
-	if ((*s)->count + 1 > (*s)->len)
-		*s = realloc_field_stack(s);
-}
-
 element *pop(stack **s)
 {
 
@@ -45,81 +38,58 @@ void push(stack **s, element e)
 	*((*s)->as + (*s)->count++) = e;
 }
 
-static init_table _itable(uint8_t init, table *fields)
+static size_t page_size(void)
 {
-	init_table tab;
-	tab.fields = fields;
-	tab.init   = init;
-	return tab;
+	static size_t size = 0;
+
+	if (!size)
+		size = (size_t)sysconf(_SC_PAGESIZE);
+	return size;
 }
 
-static init_table *_itable_ptr(size_t size)
+static size_t vstack_bytes(size_t size)
 {
-
-	init_table *ptr = NULL;
-	ptr             = ALLOC(sizeof(init_table) * size);
-	for (size_t i = 0; i < size; i++)
-		(ptr + i)->fields = NULL;
-
-	return ptr;
+	return (sizeof(element) * size + page_size() - 1) & ~(page_size() - 1);
 }
 
-field_stack *_fstack(void)
+/* Reserves the whole stack up front so it never moves, with a guard page
+ * past the end: running off it faults instead of growing. Pages are only
+ * backed once they are touched. */
+stack *_vstack(size_t size)
 {
-	field_stack *f = NULL;
-	f              = ALLOC(sizeof(field_stack));
-	f->fields      = NULL;
-
-	f->fields = _itable_ptr(MIN_SIZE);
-	f->count  = 0;
-	f->len    = MIN_SIZE;
-
-	return f;
+	size_t bytes = vstack_bytes(size);
+	stack *s     = NULL;
+	s            = ALLOC(sizeof(stack));
+
+	s->as = mmap(
+	    NULL, bytes + page_size(), PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0
+	);
+
+	if (s->as == MAP_FAILED ||
+	    mprotect((char *)s->as + bytes, page_size(), PROT_NONE) == -1)
+	{
+		fprintf(stderr, "Unable to reserve the value stack.\n");
+		exit(71);
+	}
+
+	s->count = 0;
+	s->len   = (int)(bytes / sizeof(element));
+	return s;
 }
-field_stack *realloc_field_stack(field_stack **f)
-{
-	if (!*f)
-		return _fstack();
-
-	init_table *t = NULL;
-
-	size_t size = (*f)->len * INC;
-	t           = _itable_ptr(size);
 
-	for (size_t i = 0; i < size; i++)
-		*(t + i) = *((*f)->fields + i);
-
-	FREE((*f)->fields);
-	(*f)->fields = NULL;
-	(*f)->fields = t;
-	(*f)->len    = size;
-
-	return *f;
-}
-void free_field_stack(field_stack **f)
+void free_vstack(stack **s)
 {
-	if (!*f)
+	if (!*s)
 		return;
 
-	FREE((*f)->fields);
-	(*f)->fields = NULL;
-	FREE(*f);
-	f = NULL;
+	munmap((*s)->as, vstack_bytes((*s)->len) + page_size());
+	FREE(*s);
+	*s = NULL;
 }
 
-init_table pop_itab(field_stack **f)
+bool vstack_guard(stack *s, void *addr)
 {
-	if ((*f)->count == 0)
-		return *(*f)->fields;
-	return *((*f)->fields + --(*f)->count);
-}
-
-void push_itab(field_stack **f, uint8_t init, table *field)
-{
-	check_fstack_size(f);
-
-	if (!*f || !(*f)->fields)
-		*f = _fstack();
-
-	*((*f)->fields + (*f)->count++) = _itable(init, field);
+	char *guard = (char *)(s->as + s->len);
+	return (char *)addr >= guard && (char *)addr < guard + page_size();
 }
@@ -1,4 +1,5 @@
 #include "table.h"
+#include <string.h>
 
 record *alloc_entry(record *el)
 {
@@ -9,6 +10,15 @@ record *alloc_entry(record *el)
 	tmp->val    = el->val;
 	return tmp;
 }
+/* Storing the value a record already holds, such as the same interned
+ * constant twice, must not free it. */
+static void replace_val(element *val, element with)
+{
+	if (val->obj != with.obj)
+		FREE_OBJ(val);
+	*val = with;
+}
+
 static void insert_entry(table **t, record entry)
 {
 	size_t index = entry.key->hash & ((*t)->len - 1);
@@ -21,17 +31,15 @@ static void insert_entry(table **t, record entry)
 
 	if ((*t)->records[index].key->hash == entry.key->hash)
 	{
-		FREE((*t)->records[index].key->val);
-		FREE_OBJ(&(*t)->records[index].val);
-		(*t)->records[index] = entry;
+		replace_val(&(*t)->records[index].val, entry.val);
+		(*t)->records[index].key = entry.key;
 		return;
 	}
 
 	for (record *ptr = (*t)->records[index].next; ptr; ptr = ptr->next)
 		if (ptr->key->hash == entry.key->hash)
 		{
-			FREE_OBJ(&ptr->val);
-			ptr->val = entry.val;
+			replace_val(&ptr->val, entry.val);
 			return;
 		}
 
@@ -58,6 +66,32 @@ element find_entry(table **t, _key *hash)
 	return Null();
 }
 
+/* Like find_entry, but the stored value itself, or NULL. */
+element *find_ref(table *t, _key *key)
+{
+	size_t  index = key->hash & (t->len - 1);
+	record *rec   = t->records[index].key ? &t->records[index] : NULL;
+
+	for (; rec; rec = rec->next)
+		if (rec->key->hash == key->hash)
+			return &rec->val;
+
+	return NULL;
+}
+
+/* find_entry only compares hashes; this also compares the key text. */
+element find_text(table *t, _key *key)
+{
+	size_t  index = key->hash & (t->len - 1);
+	record *rec   = t->records[index].key ? &t->records[index] : NULL;
+
+	for (; rec; rec = rec->next)
+		if (rec->key->hash == key->hash && strcmp(rec->key->val, key->val) == 0)
+			return rec->val;
+
+	return Null();
+}
+
 record Entry(_key *key, element val)
 {
 	record el;
@@ -98,21 +132,34 @@ table *realloc_table(table **t, size_t size)
 		return NULL;
 	}
 
-	record *ptr = NULL;
+	record *old = (*t)->records;
+	size_t  len = (*t)->len;
 
-	ptr = ALLOC(size * sizeof(record));
+	(*t)->records = ALLOC(size * sizeof(record));
+	(*t)->len     = (int)size;
 
-	for (size_t i = 0; i < (*t)->len; i++)
-		if ((*t)->records[i].key->val)
+	for (size_t i = 0; i < size; i++)
+		(*t)->records[i].key = NULL;
+
+	/* Rehash every entry, chained ones included, into the new buckets. */
+	for (size_t i = 0; i < len; i++)
+	{
+		if (!old[i].key)
+			continue;
+
+		record *ptr = old[i].next;
+		insert_entry(t, Entry(old[i].key, old[i].val));
+
+		while (ptr)
 		{
-			size_t index   = (*t)->records[i].key->hash & (size - 1);
-			*(ptr + index) = *((*t)->records + i);
+			record *next = ptr->next;
+			insert_entry(t, Entry(ptr->key, ptr->val));
+			FREE(ptr);
+			ptr = next;
 		}
+	}
 
-	FREE((*t)->records);
-	(*t)->records = NULL;
-	(*t)->records = ptr;
-	(*t)->len *= INC;
+	FREE(old);
 	return *t;
 }
 
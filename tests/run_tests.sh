@@ -14,7 +14,12 @@ for f in test/*.yk; do
   name=$(basename "$f" .yk)
   out="tests/actual/${name}.out"
   echo "- Running $f -> $out"
-  ./ykes "$f" > "$out" 2>&1 || true
+  input="test/${name}.in"
+  if [ -f "$input" ]; then
+    ./ykes -n "$f" < "$input" > "$out" 2>&1 || true
+  else
+    ./ykes "$f" > "$out" 2>&1 || true
+  fi
 
   expected="tests/expected/${name}.out"
   if [ -f "$expected" ]; then
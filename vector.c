@@ -3,8 +3,21 @@
 #include "table.h"
 #include "vector.h"
 
-void push_value(vector **v, element *obj)
+/* Vectors hold doubles, so integer elements are widened on the way in. */
+static element widen(element *obj)
 {
+	return (obj->type == T_INT) ? Num((double)obj->val.Int) : *obj;
+}
+
+static int index_of(element *i)
+{
+	return (i->type == T_INT) ? (int)i->val.Int : (int)i->val.Num;
+}
+
+void push_value(vector **v, element *el)
+{
+	element  num = widen(el);
+	element *obj = &num;
 
 	if ((*v)->len < (*v)->count + 1)
 		*v = _realloc_vector(v, (*v)->len * INC);
@@ -72,8 +85,10 @@ void push_obj(element **vect, element *obj)
 	}
 }
 
-static void insert_value(vector **v, element *obj, int index)
+static void insert_value(vector **v, element *el, int index)
 {
+	element  num = widen(el);
+	element *obj = &num;
 
 	if (((*v)->count + 1 > (*v)->len))
 		*v = _realloc_vector(v, (*v)->len * INC);
@@ -302,8 +317,11 @@ static void replace_string_index(char **String, int index, char Char)
 	*((*String) + index) = Char;
 }
 
-static void set_vector_index(int index, element *obj, vector **v)
+static void set_vector_index(int index, element *el, vector **v)
 {
+	element  num = widen(el);
+	element *obj = &num;
+
 	if (index > (*v)->len)
 		exit_error(
 		    "Vector index out of range, current length: %d, provided "
@@ -379,7 +397,7 @@ void _set_index(element *i, element *obj, element **vect)
 	_3d_vector *v3    = NULL;
 	_string    *av    = NULL;
 	table      *t     = NULL;
-	int         index = i->val.Num;
+	int         index = index_of(i);
 
 	switch ((*vect)->type)
 	{
@@ -452,7 +470,7 @@ static element get_string_index(int index, _string *v)
 
 element _get_index(element *i, element *obj)
 {
-	int    index = i->val.Num;
+	int    index = index_of(i);
 	table *t     = NULL;
 
 	switch (obj->type)
@@ -529,8 +547,9 @@ vector *_realloc_vector(vector **v, size_t size)
 	for (int i = 0; i < (*v)->count; i++)
 		*(of + i) = *((*v)->of + i);
 
-	FREE((*v)->of);
-	(*v)->of = NULL;
+	/* Growing a wrapped vector moves it onto VM memory, so the foreign
+	 * buffer is handed back to its owner right away. */
+	free_values(*v);
 	(*v)->of = of;
 	(*v)->len *= INC;
 
@@ -1,42 +1,166 @@
 #include <compiler.h>
 #include <error.h>
+#include <ffi.h>
+#include <io.h>
 #include <native.h>
+#include <net.h>
+#include <profile.h>
 #include <vector.h>
 #include <virtual_machine.h>
 #include <vm_util.h>
 
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
 #define COUNT() (machine.stack.main->count)
 
-#define IFIELD_COUNT() (machine.stack.init_field->count)
-#define IFIELD()       (machine.stack.init_field->fields + IFIELD_COUNT() - 1)
+/* Only a fault in the value stack's guard page is ours. Any other fault
+ * goes to the handler installed before initVM, which freeVM puts back. */
+static struct sigaction old_segv;
+
+static void stack_fault(int sig, siginfo_t *info, void *ctx)
+{
+	static const char msg[] = "ERROR: stack overflow.\n";
+
+	if (machine.stack.main && vstack_guard(machine.stack.main, info->si_addr))
+	{
+		write(STDERR_FILENO, msg, sizeof(msg) - 1);
+		_exit(70);
+	}
+
+	if (old_segv.sa_flags & SA_SIGINFO)
+		old_segv.sa_sigaction(sig, info, ctx);
+	else if (old_segv.sa_handler == SIG_DFL)
+		sigaction(sig, &old_segv, NULL); /* the fault repeats and kills us */
+	else if (old_segv.sa_handler != SIG_IGN)
+		old_segv.sa_handler(sig);
+}
+
+static frame_segment *new_segment(frame_segment *prev)
+{
+	frame_segment *seg = NULL;
+	seg                = ALLOC(sizeof(frame_segment));
+	seg->prev          = prev;
+	seg->next          = NULL;
+	return seg;
+}
+
+/* The segment after the current one is kept as a spare so a call depth
+ * hovering at a boundary does not allocate on every call; anything past
+ * the spare is released as soon as the frames drop below it. */
+static CallFrame *push_frame(void)
+{
+	if (!machine.frame)
+		machine.frame = machine.segment->frames;
+	else if (machine.frame == machine.segment->frames + FRAME_SEGMENT - 1)
+	{
+		if (!machine.segment->next)
+			machine.segment->next = new_segment(machine.segment);
+
+		machine.segment = machine.segment->next;
+		machine.frame   = machine.segment->frames;
+	}
+	else
+		machine.frame++;
+
+	machine.count.frame++;
+	return machine.frame;
+}
+
+/* Returns the caller's frame, or NULL once the outermost one is gone. */
+static CallFrame *pop_frame(void)
+{
+	if (--machine.count.frame == 0)
+		machine.frame = NULL;
+	else if (machine.frame == machine.segment->frames)
+	{
+		frame_segment *spare = machine.segment;
+
+		if (spare->next)
+		{
+			FREE(spare->next);
+			spare->next = NULL;
+		}
+
+		machine.segment = spare->prev;
+		machine.frame   = machine.segment->frames + FRAME_SEGMENT - 1;
+	}
+	else
+		machine.frame--;
+
+	return machine.frame;
+}
+
+static void free_frames(void)
+{
+	frame_segment *seg = machine.segment;
+
+	while (seg && seg->prev)
+		seg = seg->prev;
+
+	while (seg)
+	{
+		frame_segment *next = seg->next;
+		FREE(seg);
+		seg = next;
+	}
+
+	machine.segment = NULL;
+	machine.frame   = NULL;
+}
+
+void set_frame_limit(int frames)
+{
+	machine.count.frame_max = frames;
+}
 
 void initVM(void)
 {
+	struct sigaction sa;
 
 	initialize_global_mem();
 
-	machine.stack.main       = NULL;
-	machine.stack.obj        = NULL;
-	machine.stack.init_field = NULL;
+	machine.stack.main    = NULL;
+	machine.stack.obj     = NULL;
+	machine.stack.literal = NULL;
 
 	machine.glob        = NULL;
 	machine.modules     = NULL;
 	machine.open_upvals = NULL;
-	machine.caller      = NULL;
+	machine.script      = NULL;
 	machine.repl_native = NULL;
+	machine.literals    = NULL;
+
+	machine.stack.main = _vstack(STACK_MAX);
+	machine.glob       = GROW_TABLE(NULL, STACK_SIZE);
+	machine.modules    = GROW_TABLE(NULL, INIT_SIZE);
+	machine.literals   = GROW_TABLE(NULL, INIT_SIZE);
+
+	machine.stack.literal = GROW_STACK(NULL, INIT_SIZE);
+
+	sigemptyset(&sa.sa_mask);
+	sa.sa_sigaction = stack_fault;
+	sa.sa_flags     = SA_SIGINFO;
+	sigaction(SIGSEGV, &sa, &old_segv);
 
-	machine.stack.main       = GROW_STACK(NULL, STACK_SIZE);
-	machine.stack.init_field = _fstack();
-	machine.glob             = GROW_TABLE(NULL, STACK_SIZE);
-	machine.modules          = GROW_TABLE(NULL, INIT_SIZE);
+	machine.segment = new_segment(NULL);
+	machine.frame   = NULL;
 
-	machine.count.argc   = 0;
-	machine.count.frame  = 0;
-	machine.count.cargc  = 0;
-	machine.count.native = 0;
+	machine.count.argc      = 0;
+	machine.count.frame     = 0;
+	machine.count.frame_max = FRAMES_MAX;
+	machine.count.cargc     = 0;
+	machine.count.native    = 0;
 }
 void freeVM(void)
 {
+	sigaction(SIGSEGV, &old_segv, NULL);
+	stop_profile();
+	stop_count();
+	free_net();
+	free_handles();
+
 	if (machine.repl_native)
 	{
 		FREE(machine.repl_native->records);
@@ -46,14 +170,21 @@ void freeVM(void)
 	// FREE_TABLE(&machine.repl_native);
 	FREE_TABLE(&machine.glob);
 	FREE_TABLE(&machine.modules);
-	FREE_STACK(&machine.stack.main);
+	FREE_TABLE(&machine.literals);
+	free_vstack(&machine.stack.main);
 	FREE_STACK(&machine.stack.obj);
-	free_field_stack(&machine.stack.init_field);
+	FREE_STACK(&machine.stack.literal);
+	free_frames();
 
-	machine.glob        = NULL;
-	machine.repl_native = NULL;
-	machine.stack.main  = NULL;
-	machine.stack.obj   = NULL;
+	machine.glob          = NULL;
+	machine.repl_native   = NULL;
+	machine.literals      = NULL;
+	machine.stack.main    = NULL;
+	machine.stack.obj     = NULL;
+	machine.stack.literal = NULL;
+
+	free_pool();
+	yk_free_libraries();
 
 #ifdef GLOBAL_MEM_ARENA
 	destroy_global_memory();
@@ -67,73 +198,110 @@ static void runtime_error(const char *format, ...)
 	vfprintf(stderr, format, args);
 	va_end(args);
 	fputs("\n", stderr);
+}
 
-	for (int i = machine.count.frame - 1; i >= 0; i--)
-	{
+/* Prints and unwinds the call stack from the innermost frame out. `ip` is
+ * the top frame's next instruction; each frame below it resumes at the
+ * `ip_return` its callee saved. Past TRACE_FRAMES at either end, frames
+ * are unwound without being printed. */
+static void backtrace(uint8_t *ip)
+{
+	int frames = machine.count.frame;
 
-		CallFrame *frame = &machine.frames[i];
+	for (int i = frames - 1; i >= 0; i--)
+	{
+		CallFrame *frame = machine.frame;
 		function  *func  = frame->closure->func;
-		int        line  = frame->closure->func->ch.lines[i];
+		int        col   = 0;
+		int        line  = 0;
+
+		if (i < frames - TRACE_FRAMES && i >= TRACE_FRAMES)
+		{
+			if (i == frames - TRACE_FRAMES - 1)
+				fprintf(
+				    stderr, "... %d frames omitted ...\n",
+				    frames - 2 * TRACE_FRAMES
+				);
+
+			ip = frame->ip_return;
+			pop_frame();
+			continue;
+		}
+
+		if (ip)
+			line = chunk_line(&func->ch, (int)(ip - func->ch.ip) - 1, &col);
 
 		if (!func->name->val)
 			fprintf(stderr, "script\n");
 		else
 			fprintf(stderr, "%s()\n", func->name->val);
-		fprintf(stderr, "[line %d] in script\n", line);
+		fprintf(stderr, "[line %d:%d] in script\n", line, col);
+
+		ip = frame->ip_return;
+		pop_frame();
 	}
+}
 
-	machine.count.frame = 0;
+static bool arity(closure *c, uint8_t argc)
+{
+	if (c->func->arity == argc)
+		return true;
+
+	runtime_error(
+	    "ERROR: Expected `%d` args, but got `%d`.", c->func->arity, argc
+	);
+	return false;
 }
 
 static bool call(closure *c, uint8_t argc)
 {
-
-	if (c->func->arity != argc)
-	{
-		runtime_error(
-		    "ERROR: Expected `%d` args, but got `%d`.", c->func->arity, argc
-		);
+	if (!arity(c, argc))
 		return false;
-	}
 
-	if (machine.count.frame == FRAMES_MAX)
+	if (machine.count.frame == machine.count.frame_max)
 	{
 		runtime_error("ERROR: stack overflow.");
 		return false;
 	}
 
-	CallFrame *frame = machine.frames + machine.count.frame++;
+	CallFrame *frame = push_frame();
 
 	frame->closure   = NULL;
 	frame->ip        = NULL;
 	frame->ip_return = NULL;
 	frame->slots     = NULL;
 
-	frame->closure      = c;
-	frame->ip           = c->func->ch.ip;
-	frame->return_index = machine.stack.main->count - (argc + 1);
-	frame->slots        = (machine.stack.main->as + (COUNT() - (argc + 1)));
+	frame->closure = c;
+	frame->ip      = c->func->ch.ip;
+	frame->slots   = machine.stack.main->as + (COUNT() - (argc + 1));
 	return true;
 }
 
+/* Slides the callee and its arguments at `args` down over the running
+ * frame and restarts it on `c`; returns the new stack top. */
+static element *
+tail_call(CallFrame *frame, closure *c, element *args, uint8_t argc)
+{
+	close_upvalues(frame->slots);
+	memmove(frame->slots, args, sizeof(element) * (argc + 1));
+
+	frame->closure = c;
+	frame->ip      = c->func->ch.ip;
+	return frame->slots + argc + 1;
+}
+
 void init_natives(void)
 {
-	machine.stack.obj = GROW_STACK(NULL, 3);
-	define_natives(&machine.stack.obj);
 	machine.repl_native = GROW_TABLE(NULL, INIT_SIZE);
 
-	write_table(
-	    machine.repl_native, Key("clock", 5),
-	    NumType(machine.count.native++, T_NATIVE)
-	);
-	write_table(
-	    machine.repl_native, Key("square", 6),
-	    NumType(machine.count.native++, T_NATIVE)
-	);
-	write_table(
-	    machine.repl_native, Key("file", 4),
-	    NumType(machine.count.native++, T_NATIVE)
-	);
+	for (const yk_native_def *n = builtin_natives; n->name; n++)
+		write_table(
+		    machine.repl_native, Key(n->name, strlen(n->name)),
+		    NumType(machine.count.native++, T_NATIVE)
+		);
+
+	machine.stack.obj = GROW_STACK(NULL, machine.count.native);
+	define_natives(&machine.stack.obj);
 }
 
 Interpretation interpret(const char *src)
@@ -142,18 +310,20 @@ Interpretation interpret(const char *src)
 	function *func = NULL;
 
 	if (!(func = compile(src, &machine.repl_native)))
-		return INTERPRET_RUNTIME_ERR;
+		return INTERPRET_COMPILE_ERR;
 
-	closure *clos = _closure(func);
+	closure *clos  = _closure(func);
+	machine.script = clos;
 	call(clos, 0);
-	machine.frames[machine.count.frame - 1].slots = machine.stack.main->as;
+	machine.frame->slots = machine.stack.main->as;
 
+	/* Growing only carries `count` slots across, so keep the natives. */
+	machine.stack.obj->count = machine.count.native;
 	machine.stack.obj =
 	    GROW_STACK(&machine.stack.obj, machine.count.native + func->objc);
 
 	push(&machine.stack.main, GEN(clos, T_CLOSURE));
 
-	close_upvalues();
 	return run();
 }
 
@@ -164,11 +334,12 @@ interpret_path(const char *src, const char *path, const char *name)
 	function *func = NULL;
 
 	if (!(func = compile_path(src, path, name)))
-		return INTERPRET_RUNTIME_ERR;
+		return INTERPRET_COMPILE_ERR;
 
-	closure *clos = _closure(func);
+	closure *clos  = _closure(func);
+	machine.script = clos;
 	call(clos, 0);
-	machine.frames[machine.count.frame - 1].slots = machine.stack.main->as;
+	machine.frame->slots = machine.stack.main->as;
 
 	machine.stack.obj = GROW_STACK(NULL, func->objc);
 
@@ -176,10 +347,59 @@ interpret_path(const char *src, const char *path, const char *name)
 
 	push(&machine.stack.main, GEN(clos, T_CLOSURE));
 
-	// close_upvalues();
 	return run();
 }
 
+closure *find_function(const char *name)
+{
+	if (!machine.script)
+		return NULL;
+
+	stack *consts = machine.script->func->ch.constants;
+
+	for (int i = 0; i < consts->count; i++)
+	{
+		element el = consts->as[i];
+
+		if (el.type == T_CLOSURE && CLOSURE(el)->func->name &&
+		    strcmp(CLOSURE(el)->func->name->val, name) == 0)
+			return CLOSURE(el);
+	}
+	return NULL;
+}
+
+/* Runs `c` to completion from outside the interpreter loop. Only valid once
+ * the top level has returned, so the call is the sole frame and OP_RETURN
+ * hands control back here. */
+Interpretation
+call_function(closure *c, uint8_t argc, element *argv, element *result)
+{
+	int            top = COUNT();
+	Interpretation res = INTERPRET_RUNTIME_ERR;
+
+	push(&machine.stack.main, GEN(c, T_CLOSURE));
+
+	for (int i = 0; i < argc; i++)
+		push(&machine.stack.main, argv[i]);
+
+	if (call(c, argc))
+	{
+		machine.count.argc  = argc;
+		machine.count.cargc = 1;
+
+		res = run();
+	}
+
+	/* OP_RETURN pops the result off the top without clearing it. */
+	if (result)
+		*result = (res == INTERPRET_SUCCESS)
+		              ? *(machine.stack.main->as + COUNT())
+		              : Null();
+
+	COUNT() = top;
+	return res;
+}
+
 Interpretation
 interpret_export(const char *src, const char *path, const char *name)
 {
@@ -190,11 +410,11 @@ interpret_export(const char *src, const char *path, const char *name)
 	                                                 : INTERPRET_SUCCESS;
 }
 
-static uint8_t ifield_init(void)
+/* Instance storage first, then the methods the class shares. */
+static element property(table **fields, class *c, _key *key)
 {
-	if (IFIELD_COUNT() > 0)
-		return IFIELD()->init;
-	return 0;
+	element el = find_entry(fields, key);
+	return (el.type == T_NULL) ? find_entry(&c->closures, key) : el;
 }
 
 static bool call_value(element el, uint8_t argc)
@@ -220,19 +440,20 @@ static bool call_value(element el, uint8_t argc)
 	return false;
 }
 
-static upval *capture_upvalue(element *closed, uint8_t index)
+/* Open upvalues are kept sorted by slot, highest first, so two closures
+ * capturing the same slot share one upvalue. */
+static upval *capture_upvalue(element *local)
 {
 	upval *prev = NULL;
 	upval *curr = machine.open_upvals;
 
-	for (; curr && curr->index > index; curr = curr->next)
+	for (; curr && curr->location > local; curr = curr->next)
 		prev = curr;
 
-	if (curr && curr->index == index)
+	if (curr && curr->location == local)
 		return curr;
 
-	upval *new = NULL;
-	new        = _upval(*(closed + index), index);
+	upval *new = _upval(local);
 	new->next  = curr;
 
 	if (prev)
@@ -242,12 +463,46 @@ static upval *capture_upvalue(element *closed, uint8_t index)
 	return new;
 }
 
-static void close_upvalues(void)
+/* Moves the value of every open upvalue at or above `last` into the
+ * upvalue itself. */
+static void close_upvalues(element *last)
 {
-	uint8_t local = COUNT() - 1;
-	for (; machine.open_upvals && machine.open_upvals->index >= local;
-	     machine.open_upvals = machine.open_upvals->next)
-		;
+	while (machine.open_upvals && machine.open_upvals->location >= last)
+	{
+		upval *up           = machine.open_upvals;
+		up->closed          = *up->location;
+		up->location        = &up->closed;
+		machine.open_upvals = up->next;
+	}
+}
+
+/* Fills the upvalues of `c` from the descriptors at `ip` and returns the
+ * instruction after them. */
+static uint8_t *capture(CallFrame *frame, closure *c, uint8_t *ip)
+{
+	for (int i = 0; i < c->uargc; i++)
+	{
+		uint8_t kind  = *ip++;
+		int     index = *ip++;
+
+		if (kind & CAPTURE_WIDE)
+			index = (index << 8) | *ip++;
+
+		switch (kind & ~CAPTURE_WIDE)
+		{
+		case CAPTURE_LOCAL:
+			c->upvals[i] = capture_upvalue(frame->slots + index);
+			break;
+		case CAPTURE_COPY:
+			c->upvals[i]         = _upval(NULL);
+			c->upvals[i]->closed = frame->slots[index];
+			break;
+		default:
+			c->upvals[i] = frame->closure->upvals[index];
+			break;
+		}
+	}
+	return ip;
 }
 
 static bool not_null(element el)
@@ -281,39 +536,125 @@ static bool null(element el)
 	}
 }
 
+static bool for_test(element *i, element *limit, uint8_t flags)
+{
+	if (i->type == T_INT && limit->type == T_INT)
+		return (flags & FOR_LE) ? i->val.Int <= limit->val.Int
+		                        : i->val.Int < limit->val.Int;
+
+	return ((flags & FOR_LE) ? _le(limit, i) : _lt(limit, i)).val.Bool;
+}
+
+static bool switch_key(element *el, uint8_t type, Long *key)
+{
+	if (type & SWITCH_CHAR)
+	{
+		*key = el->val.Char;
+		return el->type == T_CHAR;
+	}
+
+	switch (el->type)
+	{
+	case T_INT:
+		*key = el->val.Int;
+		return true;
+	case T_NUM:
+		*key = (Long)el->val.Num;
+		return *key == el->val.Num;
+	default:
+		return false;
+	}
+}
+
+/* Slot of the table built by the compiler's jump_table() that `el`
+ * selects, or -1 for the default. */
+static int switch_slot(element *el, uint8_t type, element keys, int size)
+{
+	Long key;
+
+	if (type == SWITCH_STRING)
+	{
+		if (el->type != T_STR)
+			return -1;
+
+		_key    k    = {hash_key(STR((*el))->String), STR((*el))->String};
+		element slot = find_text(TABLE(keys), &k);
+
+		return (slot.type == T_INT) ? (int)slot.val.Int : -1;
+	}
+
+	if (!switch_key(el, type, &key))
+		return -1;
+
+	if (!(type & SWITCH_SPARSE))
+		return (key >= keys.val.Int && key - keys.val.Int < size)
+		           ? (int)(key - keys.val.Int)
+		           : -1;
+
+	value *of = VECTOR(keys)->of;
+	int    lo = 0, hi = size - 1;
+
+	while (lo <= hi)
+	{
+		int mid = (lo + hi) / 2;
+
+		if (of[mid].Int == key)
+			return mid;
+		if (of[mid].Int < key)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return -1;
+}
+
 Interpretation run(void)
 {
 
-	CallFrame *frame = machine.frames + (machine.count.frame - 1);
+	CallFrame *frame = machine.frame;
 
 	register uint8_t *ip     = frame->ip;
 	register uint8_t *ip_tmp = NULL;
 	uint16_t          offset = 0;
+	uint16_t          arg    = 0;
 	uint8_t           argc   = 0;
+	bool              tail   = false;
 	element           obj;
 	_key             *key = NULL;
 
-#define READ_BYTE() (*ip++)
-#define READ_CONSTANT()                                                        \
-	(*(frame->closure->func->ch.constants->as + READ_BYTE()))
+	/* The top of the value stack lives in `sp` while dispatching and is
+	 * written back to the VM only around calls and on the way out. */
+	register element *sp = machine.stack.main->as + COUNT();
+
+#define READ_BYTE()  (*ip++)
+#define READ_SHORT() (ip += 2, (uint16_t)((ip[-2] << 8) | ip[-1]))
+#define CONSTANT(n)  (*(frame->closure->func->ch.constants->as + (n)))
+#define READ_CONSTANT() CONSTANT(READ_BYTE())
 
-#define UPPER() ((READ_BYTE() << 8) & 0xFF)
+#define UPPER() ((READ_BYTE() << 8) & 0xFF00)
 #define LOWER() (READ_BYTE() & 0xFF)
 
-#define POP()    (pop(&machine.stack.main))
-#define POPN(n)  (popn(&machine.stack.main, n))
-#define PUSH(ar) (push(&machine.stack.main, ar))
-#define PEEK()   (*(machine.stack.main->as + (COUNT() - 1)))
-#define NPEEK(N) (*(machine.stack.main->as + (COUNT() - 1 - N)))
+#define POP()    (--sp)
+#define POPN(n)  (sp -= (int)(n))
+#define PUSH(ar) (*sp++ = (ar))
+#define PEEK()   (sp[-1])
+#define NPEEK(N) (sp[-1 - (N)])
+
+#define SYNC()   (COUNT() = (int)(sp - machine.stack.main->as))
+#define RELOAD() (sp = machine.stack.main->as + COUNT())
+#define FAIL()   (SYNC(), backtrace(ip), INTERPRET_RUNTIME_ERR)
+
+/* Pops the right operand into `obj` and folds it into the left in place. */
+#define BINARY(fn) (obj = *POP(), PEEK() = fn(&obj, &PEEK()))
 
-#define UPVALUE() ((*(frame->closure->upvals + READ_BYTE()))->closed)
+#define UPVALUE() (*(*(frame->closure->upvals + READ_BYTE()))->location)
 
 #define FALSEY() (!POP()->val.Bool)
 #define TRUTHY() (POP()->val.Bool)
 
-#define ITAB() (pop_itab(&machine.stack.init_field))
-
 #define LOCAL()   (*(frame->slots + READ_BYTE()))
+#define FOR_LIMIT(flags)                                                       \
+	((flags & FOR_LOCAL) ? LOCAL() : READ_CONSTANT())
 #define NLOCAL(n) (*(frame->slots + n))
 
 #define OBJECT()    (*(machine.stack.obj->as + READ_BYTE()))
@@ -324,47 +665,112 @@ Interpretation run(void)
 #define GET(ar)   (find_entry(&machine.glob, ar))
 #define SET(a, b) (write_table(machine.glob, a, b))
 
+/* The profiler only samples where control loops back or changes frames,
+ * so straight-line code never tests for a pending sample. */
+#define SAFEPOINT() (profile_pending ? profile_sample(ip) : (void)0)
+
+	/* Read once, as counting is only switched on before anything runs. */
+	const bool count = counting;
+
 	for (;;)
 	{
 #ifdef DEBUG_TRACE_EXECUTION
 		for (element *e = frame->slots;
-		     e < machine.stack.main->as + COUNT(); e++)
+		     e < sp; e++)
 			print(*e);
 		disassemble_instruction(
 		    &frame->closure->func->ch, (int)(ip - frame->ip)
 		);
 #endif
+		if (count)
+			count_instruction(frame->closure->func, ip);
 
 		switch (READ_BYTE())
 		{
 		case OP_CONSTANT:
 			PUSH(READ_CONSTANT());
 			break;
+		case OP_CONSTANT_LONG:
+			PUSH(CONSTANT(READ_SHORT()));
+			break;
+
+		/* The same instruction with every index operand two bytes wide;
+		 * the compiler only emits it once a one-byte index runs out. */
+		case OP_WIDE:
+			switch (READ_BYTE())
+			{
+			case OP_GET_LOCAL:
+				arg = READ_SHORT();
+				goto get_local;
+			case OP_SET_LOCAL:
+				arg = READ_SHORT();
+				goto set_local;
+			case OP_SET_LOCAL_PARAM:
+				arg = READ_SHORT();
+				goto set_local_param;
+			case OP_CLOSE_UPVAL:
+				arg = READ_SHORT();
+				goto close_upval;
+			case OP_GET_GLOBAL:
+				arg = READ_SHORT();
+				goto get_global;
+			case OP_SET_GLOBAL:
+				arg = READ_SHORT();
+				goto set_global;
+			case OP_GLOBAL_DEF:
+				arg = READ_SHORT();
+				goto global_def;
+			case OP_SET_FUNC_VAR:
+				arg = READ_SHORT();
+				goto set_func_var;
+			case OP_GET_PROP:
+				arg = READ_SHORT();
+				goto get_prop;
+			case OP_SET_PROP:
+				arg = READ_SHORT();
+				goto set_prop;
+			case OP_INVOKE:
+			case OP_TAIL_INVOKE:
+				tail = ip[-1] == OP_TAIL_INVOKE, arg = READ_SHORT();
+				goto invoke;
+			case OP_GET_OBJ:
+				arg = READ_SHORT();
+				goto get_obj;
+			case OP_SET_OBJ:
+				offset = READ_SHORT(), arg = READ_SHORT();
+				goto set_obj;
+			case OP_ALLOC_INSTANCE:
+				arg = READ_SHORT();
+				goto alloc_instance;
+			case OP_CLOSURE:
+				arg = READ_SHORT(), offset = READ_SHORT();
+				goto make_closure;
+			case OP_METHOD:
+				arg = READ_SHORT();
+				goto method;
+			default:
+				runtime_error("ERROR: Invalid wide instruction.");
+				return FAIL();
+			}
+
 		case OP_CLOSURE:
+			arg = READ_BYTE(), offset = READ_BYTE();
+		make_closure:
 		{
-			obj = READ_CONSTANT();
-
-			SET_OBJ(READ_BYTE(), obj);
+			/* Every instantiation gets its own closure; the constant only
+			 * supplies the function. */
+			closure *clos = pool_closure(CLOSURE(CONSTANT(arg))->func);
 
-			for (int i = 0; i < CLOSURE(obj)->uargc; i++)
-				CLOSURE(obj)->upvals[i] =
-				    (READ_BYTE())
-					  ? capture_upvalue(frame->slots, READ_BYTE())
-					  : frame->closure->upvals[READ_BYTE()];
+			SET_OBJ(offset, GEN(clos, T_CLOSURE));
+			ip = capture(frame, clos, ip);
 		}
 		break;
 
 		case OP_METHOD:
-		{
-			obj = READ_CONSTANT();
-
-			for (int i = 0; i < CLOSURE(obj)->uargc; i++)
-				CLOSURE(obj)->upvals[i] =
-				    (READ_BYTE())
-					  ? capture_upvalue(frame->slots, READ_BYTE())
-					  : frame->closure->upvals[READ_BYTE()];
-		}
-		break;
+			arg = READ_BYTE();
+		method:
+			ip = capture(frame, CLOSURE(CONSTANT(arg)), ip);
+			break;
 
 		case OP_GET_UPVALUE:
 			PUSH(UPVALUE());
@@ -373,71 +779,77 @@ Interpretation run(void)
 			UPVALUE() = PEEK();
 			break;
 		case OP_CLOSE_UPVAL:
+			arg = READ_BYTE();
+		close_upval:
+			close_upvalues(frame->slots + arg);
 			break;
 		case OP_NEG:
-			*(machine.stack.main->as + --COUNT()) =
-			    _neg((machine.stack.main->as + COUNT()++));
+			PEEK() = _neg(&PEEK());
 			break;
 		case OP_INC:
-			*(machine.stack.main->as + --COUNT()) =
-			    _inc((machine.stack.main->as + COUNT()++));
+			PEEK() = _inc(&PEEK());
 			break;
 		case OP_DEC:
-			*(machine.stack.main->as + --COUNT()) =
-			    _dec((machine.stack.main->as + COUNT()++));
+			PEEK() = _dec(&PEEK());
 			break;
 		case OP_POPN:
-			POPN(READ_CONSTANT().val.Num);
+			POPN(READ_BYTE());
 			break;
 		case OP_POP:
 			POP();
 			break;
 		case OP_ADD:
-			PUSH(_add(POP(), POP()));
+			BINARY(_add);
 			break;
 		case OP_SUB:
-			PUSH(_sub(POP(), POP()));
+			BINARY(_sub);
 			break;
 		case OP_MUL:
-			PUSH(_mul(POP(), POP()));
+			BINARY(_mul);
 			break;
 		case OP_MOD:
-			PUSH(_mod(POP(), POP()));
+			BINARY(_mod);
 			break;
 		case OP_DIV:
-			PUSH(_div(POP(), POP()));
+			BINARY(_div);
 			break;
 		case OP_EQ:
-			PUSH(_eq(POP(), POP()));
+			BINARY(_eq);
 			break;
 		case OP_NE:
-			PUSH(_ne(POP(), POP()));
+			BINARY(_ne);
 			break;
 		case OP_LT:
-			PUSH(_lt(POP(), POP()));
+			BINARY(_lt);
 			break;
 		case OP_LE:
-			PUSH(_le(POP(), POP()));
+			BINARY(_le);
 			break;
 		case OP_CAST:
 
-			PUSH(_cast(POP(), READ_BYTE()));
+			PEEK() = _cast(&PEEK(), READ_BYTE());
 			break;
 		case OP_TO_STR:
 			if (PEEK().type != T_STR)
-				PUSH(_to_str(POP()));
+				PEEK() = _to_str(&PEEK());
 			break;
 		case OP_GT:
-			PUSH(_gt(POP(), POP()));
+			BINARY(_gt);
 			break;
 		case OP_GE:
-			PUSH(_ge(POP(), POP()));
+			BINARY(_ge);
+			break;
+		case OP_BIT_AND:
+			BINARY(_bit_and);
+			break;
+		case OP_BIT_OR:
+			BINARY(_bit_or);
 			break;
 		case OP_OR:
-			PUSH(_or(POP(), POP()));
+			BINARY(_or);
 			break;
 		case OP_AND:
-			PUSH(_and(POP(), POP()));
+			BINARY(_and);
 			break;
 		case OP_RESET_ARGC:
 			machine.count.cargc = 0;
@@ -447,55 +859,37 @@ Interpretation run(void)
 			PUSH(Null());
 			break;
 
-		case OP_CLASS:
-		{
-			element e = OBJECT();
-			class  *c = NULL;
-
-			c = (e.type == T_MODULE) ? CLASS(RECORD(e)->val) : CLASS(e);
-
-			push_itab(
-			    &machine.stack.init_field, 1, copy_table(c->closures)
-			);
-			PUSH(GEN(c->init, T_CLOSURE));
-			break;
-		}
 		case OP_ALLOC_INSTANCE:
+			arg = READ_BYTE();
+		alloc_instance:
 		{
-
+			element   e    = NOB_JECT(arg);
 			instance *inst = NULL;
-			inst           = _instance(CLASS(OBJECT()));
-			uint8_t init   = READ_BYTE();
 
-			inst->fields = (init) ? ITAB().fields
-			                      : copy_table(inst->classc->closures);
+			inst = _instance(
+			    (e.type == T_MODULE) ? CLASS(RECORD(e)->val) : CLASS(e)
+			);
+			inst->fields = GROW_TABLE(NULL, INIT_SIZE);
 
 			PUSH(GEN(inst, T_INSTANCE));
 			break;
 		}
-		case OP_THIS:
-			if (machine.caller != NULL)
-				PUSH(GEN(machine.caller, T_INSTANCE));
-			break;
 		case OP_SET_PROP:
+			arg = READ_BYTE();
+		set_prop:
 		{
+			obj          = *POP();
+			element inst = *POP();
 
-			obj            = *POP();
-			element inst   = *POP();
-			uint8_t ifield = ifield_init();
-
-			if (inst.type != T_INSTANCE && !ifield)
+			if (inst.type != T_INSTANCE)
 			{
 				runtime_error(
 				    "ERROR: Can only set properties of an instance."
 				);
-				return INTERPRET_RUNTIME_ERR;
+				return FAIL();
 			}
 
-			write_table(
-			    ifield ? IFIELD()->fields : INSTANCE(inst)->fields,
-			    KEY(READ_CONSTANT()), obj
-			);
+			write_table(INSTANCE(inst)->fields, KEY(CONSTANT(arg)), obj);
 			PUSH(obj);
 		}
 		break;
@@ -507,36 +901,36 @@ Interpretation run(void)
 		}
 
 		case OP_GET_OBJ:
-			PUSH(OBJECT());
+			arg = READ_BYTE();
+		get_obj:
+			PUSH(NOB_JECT(arg));
 			break;
 		case OP_SET_OBJ:
-			argc = READ_BYTE();
-			SET_OBJ(argc, READ_CONSTANT());
+			offset = READ_BYTE(), arg = READ_BYTE();
+		set_obj:
+			SET_OBJ(offset, CONSTANT(arg));
 			break;
 
 		case OP_GET_PROP:
+			arg = READ_BYTE();
+		get_prop:
 		{
 
-			element inst   = *POP();
-			uint8_t ifield = ifield_init();
+			element inst = *POP();
 
-			if (inst.type != T_INSTANCE && !ifield)
+			if (inst.type != T_INSTANCE)
 			{
 				runtime_error(
 				    "ERROR: Only instances contain properties."
 				);
-				return INTERPRET_RUNTIME_ERR;
+				return FAIL();
 			}
 
-			key = KEY(READ_CONSTANT());
+			key = KEY(CONSTANT(arg));
 
-			if (ifield)
-				obj = find_entry(&IFIELD()->fields, key);
-			else
-			{
-				obj = find_entry(&INSTANCE(inst)->fields, key);
-				machine.caller = INSTANCE(inst);
-			}
+			obj = property(
+			    &INSTANCE(inst)->fields, INSTANCE(inst)->classc, key
+			);
 
 			if (obj.type != T_NULL)
 			{
@@ -544,7 +938,7 @@ Interpretation run(void)
 				break;
 			}
 			runtime_error("ERROR: Undefined property '%s'.", key->val);
-			return INTERPRET_RUNTIME_ERR;
+			return FAIL();
 		}
 		case OP_SET_ACCESS:
 		{
@@ -561,28 +955,50 @@ Interpretation run(void)
 		}
 		case OP_GET_ACCESS:
 
-			if ((obj = _get_index(POP(), POP())).type == T_NULL)
+			obj = *POP();
+
+			if ((obj = _get_index(&obj, POP())).type == T_NULL)
 			{
 				runtime_error("Invalid array access");
-				return INTERPRET_RUNTIME_ERR;
+				return FAIL();
 			}
 			PUSH(obj);
 			break;
 		case OP_CALL:
+		case OP_TAIL_CALL:
 		{
+			tail               = ip[-1] == OP_TAIL_CALL;
 			uint8_t argc       = READ_BYTE();
 			uint8_t is_closure = 0;
 
+			if (tail && NPEEK(argc).type == T_CLOSURE)
+			{
+				if (!arity(CLOSURE(NPEEK(argc)), argc))
+					return FAIL();
+
+				sp = tail_call(frame, CLOSURE(NPEEK(argc)), sp - argc - 1, argc);
+				ip = frame->ip;
+
+				machine.count.argc  = argc;
+				machine.count.cargc = 1;
+				SAFEPOINT();
+				break;
+			}
+
 			if (NPEEK(argc).type == T_CLOSURE)
 			{
 				ip_tmp     = ip;
 				is_closure = 1;
 			}
 
+			SYNC();
+
 			if (!call_value(NPEEK(argc), argc))
-				return INTERPRET_RUNTIME_ERR;
+				return FAIL();
+
+			RELOAD();
 
-			frame = (machine.frames + (machine.count.frame - 1));
+			frame = machine.frame;
 
 			if (is_closure)
 			{
@@ -593,12 +1009,134 @@ Interpretation run(void)
 
 			machine.count.argc  = argc;
 			machine.count.cargc = 1;
+			SAFEPOINT();
+			break;
+		}
+		case OP_INVOKE:
+		case OP_TAIL_INVOKE:
+			tail = ip[-1] == OP_TAIL_INVOKE, arg = READ_BYTE();
+		invoke:
+		{
+			key  = KEY(CONSTANT(arg));
+			argc = READ_BYTE();
+
+			element *recv = &NPEEK(argc);
+
+			if (recv->type != T_INSTANCE)
+			{
+				runtime_error("ERROR: Only instances have methods.");
+				return FAIL();
+			}
+
+			obj = property(
+			    &INSTANCE((*recv))->fields, INSTANCE((*recv))->classc, key
+			);
+
+			if (obj.type == T_NULL)
+			{
+				runtime_error("ERROR: Undefined property '%s'.", key->val);
+				return FAIL();
+			}
+
+			SYNC();
+
+			/* A closure runs with the receiver left in slot 0; any other
+			 * callable field takes the receiver's place. */
+			if (obj.type == T_CLOSURE && tail)
+			{
+				if (!arity(CLOSURE(obj), argc))
+					return FAIL();
+
+				sp = tail_call(frame, CLOSURE(obj), recv, argc);
+				ip = frame->ip;
+			}
+			else if (obj.type == T_CLOSURE)
+			{
+				if (!call(CLOSURE(obj), argc))
+					return FAIL();
+
+				ip_tmp           = ip;
+				frame            = machine.frame;
+				ip               = frame->ip;
+				frame->ip_return = ip_tmp;
+				ip_tmp           = NULL;
+			}
+			else
+			{
+				if (!call_value((*recv = obj), argc))
+					return FAIL();
+				RELOAD();
+			}
+
+			machine.count.argc  = argc;
+			machine.count.cargc = 1;
+			SAFEPOINT();
 			break;
 		}
-		case OP_INSTANCE:
-			machine.count.argc  = READ_BYTE();
+		case OP_INIT:
+		{
+			argc = READ_BYTE();
+
+			SYNC();
+
+			/* OP_ALLOC_INSTANCE left the receiver under the arguments. */
+			if (!call(INSTANCE(NPEEK(argc))->classc->init, argc))
+				return FAIL();
+
+			ip_tmp           = ip;
+			frame            = machine.frame;
+			ip               = frame->ip;
+			frame->ip_return = ip_tmp;
+			ip_tmp           = NULL;
+
+			machine.count.argc  = argc;
 			machine.count.cargc = 1;
 			break;
+		}
+		case OP_CALL_NATIVE:
+		{
+			native  *nat  = NATIVE(OBJECT());
+			element *argv = NULL;
+
+			argc = READ_BYTE();
+			argv = sp - argc;
+
+			/* The stack count is kept current while native code runs, but
+			 * a native must not call back into the VM: run() is not
+			 * re-entrant, so yk_call is off limits here. */
+			SYNC();
+			obj = nat->fn(argc, argv);
+
+			if (argc == 0)
+				PUSH(obj);
+			else
+			{
+				*argv = obj;
+				sp    = argv + 1;
+			}
+			break;
+		}
+		case OP_SQRT:
+			PEEK() = _sqr(&PEEK());
+			break;
+		case OP_ABS:
+			PEEK() = _abs(&PEEK());
+			break;
+		case OP_FLOOR:
+			PEEK() = _floor(&PEEK());
+			break;
+		case OP_MIN:
+			obj    = *POP();
+			PEEK() = _min(&PEEK(), &obj);
+			break;
+		case OP_MAX:
+			obj    = *POP();
+			PEEK() = _max(&PEEK(), &obj);
+			break;
+		case OP_POW:
+			obj    = *POP();
+			PEEK() = _pow(&PEEK(), &obj);
+			break;
 		case OP_JMPF:
 			offset = UPPER(), offset = (offset | LOWER()) * FALSEY();
 			ip += offset;
@@ -629,29 +1167,87 @@ Interpretation run(void)
 		case OP_LOOP:
 			offset = UPPER(), offset |= LOWER();
 			ip -= offset;
+			SAFEPOINT();
+			break;
+		case OP_SWITCH:
+		{
+			uint8_t type = READ_BYTE();
+
+			obj    = READ_CONSTANT();
+			offset = UPPER(), offset |= LOWER();
+
+			uint16_t *table = frame->closure->func->ch.cases.bytes + offset;
+			int       slot  = switch_slot(POP(), type, obj, table[0]);
+
+			ip = frame->ip + table[(slot == -1) ? 1 : slot + 2];
+			break;
+		}
+		case OP_FOR_PREP:
+		{
+			element *i     = &LOCAL();
+			uint8_t  flags = READ_BYTE();
+
+			obj    = FOR_LIMIT(flags);
+			offset = UPPER(), offset |= LOWER();
+
+			if (!for_test(i, &obj, flags))
+				ip += offset;
+			break;
+		}
+		case OP_FOR_LOOP:
+		{
+			element *i     = &LOCAL();
+			uint8_t  flags = READ_BYTE();
+
+			obj    = FOR_LIMIT(flags);
+			offset = UPPER(), offset |= LOWER();
+
+			if (i->type == T_INT && obj.type == T_INT &&
+			    i->val.Int < obj.val.Int)
+			{
+				if (++i->val.Int < obj.val.Int ||
+				    ((flags & FOR_LE) && i->val.Int == obj.val.Int))
+					ip -= offset;
+			}
+			else
+			{
+				*i = _inc(i);
+
+				if (for_test(i, &obj, flags))
+					ip -= offset;
+			}
+			SAFEPOINT();
 			break;
+		}
 		case OP_GET_LOCAL:
-			PUSH(LOCAL());
+			arg = READ_BYTE();
+		get_local:
+			PUSH(NLOCAL(arg));
 			break;
 		case OP_SET_LOCAL:
-			LOCAL() = PEEK();
+			arg = READ_BYTE();
+		set_local:
+			NLOCAL(arg) = PEEK();
 			break;
 		case OP_SET_LOCAL_PARAM:
-			LOCAL() = (machine.count.cargc < machine.count.argc)
+			arg = READ_BYTE();
+		set_local_param:
+			NLOCAL(arg) = (machine.count.cargc < machine.count.argc)
 			              ? *(frame->slots + machine.count.cargc++)
 			              : PEEK();
 
 			break;
 		case OP_LEN:
-			PUSH(_len(POP()));
+			PEEK() = _len(&PEEK());
 			break;
 		case OP_RM:
 			FREE_OBJ(POP());
 			break;
 		case OP_DELETE_VAL:
 		{
+			obj = *POP();
 
-			int      index = POP()->val.Num;
+			int      index = NUM(obj);
 			element *v     = NULL;
 			v              = POP();
 			delete_index(&v, index);
@@ -661,7 +1257,8 @@ Interpretation run(void)
 		{
 
 			element *o     = POP();
-			int      index = POP()->val.Num;
+			obj            = *POP();
+			int      index = NUM(obj);
 			// v              = VECTOR((*POP()));
 			element *vect = POP();
 			_insert(&vect, o, (Long)index);
@@ -681,18 +1278,21 @@ Interpretation run(void)
 			break;
 		}
 		case OP_ALLOC_TABLE:
-			if (PEEK().type != T_NUM)
+			if (!IS_NUM(PEEK()))
 			{
 				runtime_error(
 				    "ERROR: table argument must be "
 				    "a numeric value."
 				);
-				return INTERPRET_RUNTIME_ERR;
+				return FAIL();
 			}
-			PUSH(GEN(GROW_TABLE(NULL, POP()->val.Num), T_TABLE));
+			obj = *POP();
+			PUSH(GEN(GROW_TABLE(NULL, NUM(obj)), T_TABLE));
 			break;
 		case OP_GET_GLOBAL:
-			key = KEY(READ_CONSTANT());
+			arg = READ_BYTE();
+		get_global:
+			key = KEY(CONSTANT(arg));
 			obj = GET(key);
 
 			if (obj.type != T_NULL)
@@ -702,9 +1302,11 @@ Interpretation run(void)
 			}
 
 			runtime_error("ERROR: Undefined property '%s'.", key->val);
-			return INTERPRET_RUNTIME_ERR;
+			return FAIL();
 		case OP_GLOBAL_DEF:
-			key = KEY(READ_CONSTANT());
+			arg = READ_BYTE();
+		global_def:
+			key = KEY(CONSTANT(arg));
 			obj = *POP();
 
 			if (GET(key).type != T_NULL)
@@ -714,16 +1316,20 @@ Interpretation run(void)
 				    "identifier: %s\n",
 				    key->val
 				);
-				return INTERPRET_RUNTIME_ERR;
+				return FAIL();
 			}
 
 			SET(key, obj);
 			break;
 		case OP_SET_GLOBAL:
-			SET(KEY(READ_CONSTANT()), *POP());
+			arg = READ_BYTE();
+		set_global:
+			SET(KEY(CONSTANT(arg)), *POP());
 			break;
 		case OP_SET_FUNC_VAR:
-			key = KEY(READ_CONSTANT());
+			arg = READ_BYTE();
+		set_func_var:
+			key = KEY(CONSTANT(arg));
 			obj = (machine.count.cargc < machine.count.argc)
 			          ? *(frame->slots + machine.count.cargc++)
 			          : *POP();
@@ -735,20 +1341,25 @@ Interpretation run(void)
 			break;
 		case OP_RETURN:
 			obj = *POP();
-			--machine.count.frame;
+			close_upvalues(frame->slots);
 
-			if (machine.count.frame == 0)
+			if (!pop_frame())
+			{
+				SYNC();
 				return INTERPRET_SUCCESS;
+			}
 
-			machine.stack.main->count = frame->return_index;
+			sp = frame->slots;
 			PUSH(obj);
 
 			ip    = frame->ip_return;
-			frame = &machine.frames[machine.count.frame - 1];
+			frame = machine.frame;
+			SAFEPOINT();
 			break;
 		}
 	}
 #undef READ_BYTE
+#undef CONSTANT
 #undef UPPER
 #undef LOWER
 #undef READ_SHORT
@@ -758,6 +1369,10 @@ Interpretation run(void)
 #undef PUSH
 #undef PEEK
 #undef NPEEK
+#undef SYNC
+#undef RELOAD
+#undef FAIL
+#undef BINARY
 #undef FALSEY
 #undef TRUTHY
 #undef LOCAL
@@ -765,4 +1380,5 @@ Interpretation run(void)
 #undef OBJECT
 #undef GET
 #undef SET
+#undef SAFEPOINT
 }